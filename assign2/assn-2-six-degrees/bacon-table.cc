@@ -0,0 +1,86 @@
+#include "bacon-table.h"
+#include <algorithm>
+using namespace std;
+
+static const int kTableMagic = 0x4e434142; // "BACN" on little-endian machines
+
+baconTable::baconTable(const imdbGraph& graph, int centre, int numThreads) : mapped(NULL)
+{
+  vector<int> distance;
+  vector<imdbGraph::link> parent;
+  graph.breadthFirstSearch(centre, -1, numThreads, distance, parent);
+
+  int numActors = graph.getNumActors();
+  built.resize(sizeof(tableHeader) + numActors * (sizeof(imdbGraph::link) + 1));
+  tableHeader *table = (tableHeader *) built.data();
+  table->magic = kTableMagic;
+  table->numActors = numActors;
+  table->numMovies = graph.getNumMovies();
+  table->numCredits = graph.getNumCredits();
+  table->centre = centre;
+  table->reserved = 0;
+  table->dataSize = graph.getDataSize();
+
+  imdbGraph::link *tableParents = (imdbGraph::link *) (table + 1);
+  unsigned char *tableDistances = (unsigned char *) (tableParents + numActors);
+  copy(parent.begin(), parent.end(), tableParents);
+  for (int i = 0; i < numActors; i++)
+    tableDistances[i] = distance[i] == -1 ? kUnreachable : min(distance[i], kUnreachable - 1);
+  attach(built.data());
+}
+
+baconTable::baconTable(const imdbGraph& graph, const string& fileName) : header(NULL)
+{
+  mapped = new mappedFile(fileName);
+  const tableHeader *table = (const tableHeader *) mapped->data();
+  if (table == NULL || mapped->size() < sizeof(tableHeader)) return;
+  if (table->magic != kTableMagic || table->numActors != graph.getNumActors() ||
+      table->numMovies != graph.getNumMovies() || table->numCredits != graph.getNumCredits() ||
+      table->dataSize != (long long) graph.getDataSize() ||
+      table->centre < 0 || table->centre >= table->numActors ||
+      mapped->size() != sizeof(tableHeader) + table->numActors * (sizeof(imdbGraph::link) + 1)) return;
+  attach((const char *) table);
+}
+
+void baconTable::attach(const char *table)
+{
+  header = (const tableHeader *) table;
+  parents = (const imdbGraph::link *) (header + 1);
+  distances = (const unsigned char *) (parents + header->numActors);
+}
+
+baconTable::~baconTable()
+{
+  delete mapped;
+}
+
+bool baconTable::save(const string& fileName) const
+{
+  size_t numBytes = sizeof(tableHeader) + header->numActors * (sizeof(imdbGraph::link) + 1);
+  return mappedFile::writeAtomically(fileName, header, numBytes);
+}
+
+int baconTable::getDistance(int actor) const
+{
+  if (actor < 0 || actor >= header->numActors || distances[actor] == kUnreachable) return -1;
+  return distances[actor];
+}
+
+bool baconTable::tracePathToCentre(int actor, vector<imdbGraph::link>& links) const
+{
+  links.clear();
+  if (getDistance(actor) == -1) return false;
+  for (; actor != header->centre; actor = parents[actor].actor)
+    links.push_back({parents[actor].movie, parents[actor].actor});
+  return true;
+}
+
+bool baconTable::tracePathFromCentre(int actor, vector<imdbGraph::link>& links) const
+{
+  links.clear();
+  if (getDistance(actor) == -1) return false;
+  for (; actor != header->centre; actor = parents[actor].actor)
+    links.push_back({parents[actor].movie, actor});
+  reverse(links.begin(), links.end());
+  return true;
+}
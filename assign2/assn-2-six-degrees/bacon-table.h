@@ -0,0 +1,136 @@
+#ifndef __bacon_table__
+#define __bacon_table__
+
+#include "imdb-graph.h"
+#include "mapped-file.h"
+#include <string>
+#include <vector>
+using namespace std;
+
+/**
+ * Class: baconTable
+ * -----------------
+ * The result of one full breadth-first search out of a fixed centre actor
+ * (the canonical centre being Kevin Bacon): the distance from the centre to
+ * every actor, and the movie and actor through which every actor was reached.
+ * With the table in hand, the distance between the centre and any actor is a
+ * single lookup, and the path between them is a walk of its own length,
+ * with no search at all.
+ *
+ * Tables can be saved to disk and mapped back in on later runs, so the
+ * search only ever needs to be run once per centre and data set.  On disk,
+ * a table is a header followed by one imdbGraph::link per actor and then
+ * one distance byte per actor (kUnreachable if the actor isn't connected
+ * to the centre at all).
+ */
+
+class baconTable {
+
+ public:
+
+  /**
+   * Constructor: baconTable
+   * -----------------------
+   * Builds the table by searching the entire graph out of the
+   * specified centre, with every level spread across numThreads threads.
+   */
+
+  baconTable(const imdbGraph& graph, int centre, int numThreads);
+
+  /**
+   * Constructor: baconTable
+   * -----------------------
+   * Maps a table previously saved to the specified file.  If the file is
+   * missing, or was built from a graph other than the one specified, then
+   * good() returns false and the table shouldn't be used.
+   */
+
+  baconTable(const imdbGraph& graph, const string& fileName);
+
+  /**
+   * Methods: good
+   *          save
+   * --------------
+   * good() is true if and only if the table can be used.  save writes the
+   * table to the specified file so that it can be mapped later on, and
+   * returns true if and only if that worked.
+   */
+
+  bool good() const { return header != NULL; }
+  bool save(const string& fileName) const;
+
+  /**
+   * Constant: kFileName
+   * -------------------
+   * The name the table is saved under in a data directory, where six-degrees --centre looks for it and saves it.
+   */
+
+  static constexpr const char *kFileName = "bacontable";
+
+  /**
+   * Methods: getCentre
+   *          getDistance
+   * --------------------
+   * getCentre returns the id of the centre actor.  getDistance returns
+   * the number of movies between the centre and the specified actor, or
+   * -1 if there's no path between them.
+   */
+
+  int getCentre() const { return header->centre; }
+  int getDistance(int actor) const;
+
+  /**
+   * Methods: tracePathToCentre
+   *          tracePathFromCentre
+   * ----------------------------
+   * Builds the legs of a shortest path from the specified actor to the
+   * centre, or from the centre out to the specified actor, in the form
+   * imdbGraph::decodePath expects.
+   *
+   * @return true if and only if there's a path between the two.
+   */
+
+  bool tracePathToCentre(int actor, vector<imdbGraph::link>& links) const;
+  bool tracePathFromCentre(int actor, vector<imdbGraph::link>& links) const;
+
+  /**
+   * Constant: kUnreachable
+   * ----------------------
+   * The distance byte stored for actors not connected to the centre.
+   */
+
+  static const unsigned char kUnreachable = 255;
+
+  /**
+   * Destructor: ~baconTable
+   * -----------------------
+   * Releases the table, unmapping it if it was mapped from a file.
+   */
+
+  ~baconTable();
+
+ private:
+  struct tableHeader {
+    int magic;
+    int numActors;
+    int numMovies;
+    int numCredits;
+    int centre;
+    int reserved;
+    long long dataSize;         // imdb::getDataSize of the data the table was built from
+  };
+
+  const tableHeader *header;
+  const imdbGraph::link *parents;
+  const unsigned char *distances;
+  vector<char> built;
+  mappedFile *mapped;
+
+  void attach(const char *table);
+
+  // marked as private so tables can't be copy constructed or reassigned.
+  baconTable(const baconTable& original);
+  baconTable& operator=(const baconTable& rhs);
+};
+
+#endif
@@ -0,0 +1,99 @@
+#include "component-table.h"
+#include <algorithm>
+using namespace std;
+
+static const int kTableMagic = 0x504d4f43; // "COMP" on little-endian machines
+
+/**
+ * Union-find over actor ids, with path halving and union by size.
+ */
+
+static int findRoot(vector<int>& parent, int actor)
+{
+  while (parent[actor] != actor) {
+    parent[actor] = parent[parent[actor]];
+    actor = parent[actor];
+  }
+  return actor;
+}
+
+componentTable::componentTable(const imdbGraph& graph) : mapped(NULL)
+{
+  int numActors = graph.getNumActors();
+  vector<int> parent(numActors), rootSize(numActors, 1);
+  for (int i = 0; i < numActors; i++) parent[i] = i;
+  for (int movie = 0; movie < graph.getNumMovies(); movie++) {
+    int numCast;
+    const int *cast = graph.getCast(movie, numCast);
+    for (int i = 1; i < numCast; i++) {
+      int a = findRoot(parent, cast[0]), b = findRoot(parent, cast[i]);
+      if (a == b) continue;
+      if (rootSize[a] < rootSize[b]) swap(a, b);
+      parent[b] = a;
+      rootSize[a] += rootSize[b];
+    }
+  }
+
+  // number the components by decreasing size (ties by smallest member)
+  vector<int> roots;
+  for (int i = 0; i < numActors; i++)
+    if (findRoot(parent, i) == i) roots.push_back(i);
+  stable_sort(roots.begin(), roots.end(), [&](int a, int b) { return rootSize[a] > rootSize[b]; });
+  int numComponents = roots.size();
+  vector<int> number(numActors);
+  for (int c = 0; c < numComponents; c++) number[roots[c]] = c;
+
+  built.resize(tableSize(numActors, numComponents));
+  tableHeader *table = (tableHeader *) built.data();
+  table->magic = kTableMagic;
+  table->numActors = numActors;
+  table->numMovies = graph.getNumMovies();
+  table->numCredits = graph.getNumCredits();
+  table->numComponents = numComponents;
+  table->reserved = 0;
+  table->dataSize = graph.getDataSize();
+
+  int *tableComponents = (int *) (table + 1);
+  int *tableSizes = tableComponents + numActors;
+  for (int i = 0; i < numActors; i++) tableComponents[i] = number[findRoot(parent, i)];
+  for (int c = 0; c < numComponents; c++) tableSizes[c] = rootSize[roots[c]];
+  attach(built.data());
+}
+
+componentTable::componentTable(const imdbGraph& graph, const string& fileName) : header(NULL)
+{
+  mapped = new mappedFile(fileName);
+  const tableHeader *table = (const tableHeader *) mapped->data();
+  if (table == NULL || mapped->size() < sizeof(tableHeader)) return;
+  if (table->magic != kTableMagic || table->numActors != graph.getNumActors() ||
+      table->numMovies != graph.getNumMovies() || table->numCredits != graph.getNumCredits() ||
+      table->dataSize != (long long) graph.getDataSize() ||
+      table->numComponents < 0 || table->numComponents > table->numActors ||
+      mapped->size() != tableSize(table->numActors, table->numComponents)) return;
+  const int *tableComponents = (const int *) (table + 1);
+  for (int i = 0; i < table->numActors; i++)
+    if (tableComponents[i] < 0 || tableComponents[i] >= table->numComponents) return;
+  attach((const char *) table);
+}
+
+size_t componentTable::tableSize(int numActors, int numComponents)
+{
+  return sizeof(tableHeader) + (numActors + (size_t) numComponents) * sizeof(int);
+}
+
+void componentTable::attach(const char *table)
+{
+  header = (const tableHeader *) table;
+  components = (const int *) (header + 1);
+  sizes = components + header->numActors;
+}
+
+componentTable::~componentTable()
+{
+  delete mapped;
+}
+
+bool componentTable::save(const string& fileName) const
+{
+  return mappedFile::writeAtomically(fileName, header, tableSize(header->numActors, header->numComponents));
+}
@@ -0,0 +1,112 @@
+#ifndef __component_table__
+#define __component_table__
+
+#include "imdb-graph.h"
+#include "mapped-file.h"
+#include <string>
+#include <vector>
+using namespace std;
+
+/**
+ * Class: componentTable
+ * ---------------------
+ * Labels every actor with the connected component it belongs to, so that
+ * two actors with no path between them can be told apart in constant time,
+ * without searching the whole of one of their components first.  Components
+ * are numbered in order of decreasing size, so component 0 is the giant one
+ * nearly every actor belongs to.
+ *
+ * On disk, a table is a header, followed by one component number per actor,
+ * followed by the number of actors in each component.
+ */
+
+class componentTable {
+
+ public:
+
+  /**
+   * Constructor: componentTable
+   * ---------------------------
+   * Builds the table with a single union-find pass over every cast.
+   */
+
+  componentTable(const imdbGraph& graph);
+
+  /**
+   * Constructor: componentTable
+   * ---------------------------
+   * Maps a table previously saved to the specified file.  If the file is
+   * missing, or was built from a graph other than the one specified, then
+   * good() returns false and the table shouldn't be used.
+   */
+
+  componentTable(const imdbGraph& graph, const string& fileName);
+
+  /**
+   * Methods: good
+   *          save
+   * --------------
+   * Self-explanatory, and the same as baconTable's.
+   */
+
+  bool good() const { return header != NULL; }
+  bool save(const string& fileName) const;
+
+  /**
+   * Constant: kFileName
+   * -------------------
+   * The name the table is saved under in a data directory, where six-degrees --components looks for it and saves it.
+   */
+
+  static constexpr const char *kFileName = "components";
+
+  /**
+   * Methods: getNumComponents
+   *          getComponent
+   *          getComponentSize
+   *          connected
+   * --------------------------
+   * getComponent returns the component the specified actor belongs to,
+   * and getComponentSize the number of actors in the specified component.
+   * connected is true if and only if there's a path between the two actors.
+   */
+
+  int getNumComponents() const { return header->numComponents; }
+  int getComponent(int actor) const { return components[actor]; }
+  int getComponentSize(int component) const { return sizes[component]; }
+  bool connected(int source, int target) const { return components[source] == components[target]; }
+
+  /**
+   * Destructor: ~componentTable
+   * ---------------------------
+   * Releases the table, unmapping it if it was mapped from a file.
+   */
+
+  ~componentTable();
+
+ private:
+  struct tableHeader {
+    int magic;
+    int numActors;
+    int numMovies;
+    int numCredits;
+    int numComponents;
+    int reserved;
+    long long dataSize;         // imdb::getDataSize of the data the table was built from
+  };
+
+  const tableHeader *header;
+  const int *components;
+  const int *sizes;
+  vector<char> built;
+  mappedFile *mapped;
+
+  void attach(const char *table);
+  static size_t tableSize(int numActors, int numComponents);
+
+  // marked as private so tables can't be copy constructed or reassigned.
+  componentTable(const componentTable& original);
+  componentTable& operator=(const componentTable& rhs);
+};
+
+#endif
@@ -0,0 +1,294 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "imdb.h"
+#include "imdb-graph.h"
+#include "component-table.h"
+#include "parallel-bfs.h"
+using namespace std;
+
+/**
+ * What one full search out of an actor found: the number of actors at each
+ * distance from it (in movies), and its eccentricity, the greatest of those
+ * distances.
+ */
+
+struct sampledSearch {
+  int actor;
+  int eccentricity;
+  vector<long long> atDistance;
+};
+
+/**
+ * Runs a full, single-threaded search out of every sampled actor, spreading
+ * the searches across numThreads threads, each of which reuses its own
+ * distances and parents for every search it runs.
+ */
+
+static void runSamples(const imdbGraph& graph, vector<sampledSearch>& samples, int numThreads)
+{
+  atomic<int> next(0);
+  vector<thread> workers;
+  for (int t = 0; t < numThreads; t++) {
+    workers.push_back(thread([&]() {
+      vector<int> distances;
+      vector<imdbGraph::link> parents;
+      for (int j = next++; j < (int) samples.size(); j = next++) {
+        sampledSearch& s = samples[j];
+        graph.breadthFirstSearch(s.actor, -1, 1, distances, parents);
+        s.eccentricity = 0;
+        for (int distance: distances) {
+          if (distance < 0) continue;
+          if ((int) s.atDistance.size() <= distance) s.atDistance.resize(distance + 1, 0);
+          s.atDistance[distance]++;
+          s.eccentricity = max(s.eccentricity, distance);
+        }
+      }
+    }));
+  }
+  for (thread& worker: workers) worker.join();
+}
+
+/**
+ * Counts the distinct co-stars of every actor, which is how many actors a
+ * search reaches in a single step out of it, spreading the actors across
+ * numThreads threads.  Each thread marks the co-stars it has already counted
+ * with the actor it's counting them for, so the marks never need clearing.
+ */
+
+static void countCostars(const imdbGraph& graph, vector<int>& costars, int numThreads)
+{
+  int numActors = graph.getNumActors();
+  costars.assign(numActors, 0);
+  vector<vector<int> > marks(max(1, numThreads));
+  parallelFor(numThreads, numActors, [&](int begin, int end, int t) {
+    vector<int>& mark = marks[t];
+    if (mark.empty()) mark.assign(numActors, -1);
+    for (int actor = begin; actor < end; actor++) {
+      int numCredits;
+      const int *credits = graph.getCredits(actor, numCredits);
+      for (int i = 0; i < numCredits; i++) {
+        int numCast;
+        const int *cast = graph.getCast(credits[i], numCast);
+        for (int j = 0; j < numCast; j++) {
+          if (cast[j] == actor || mark[cast[j]] == actor) continue;
+          mark[cast[j]] = actor;
+          costars[actor]++;
+        }
+      }
+    }
+  });
+}
+
+/**
+ * Publishes a histogram of the specified values in power-of-two buckets
+ * (0, then 1, 2-3, 4-7 and so on), one tab-separated line per non-empty
+ * bucket, under the specified name.
+ */
+
+static void reportHistogram(const string& name, const vector<int>& values)
+{
+  vector<long long> buckets;
+  for (int value: values) {
+    int bucket = 0;
+    while (value >= (1 << bucket)) bucket++;
+    if ((int) buckets.size() <= bucket) buckets.resize(bucket + 1, 0);
+    buckets[bucket]++;
+  }
+  for (size_t bucket = 0; bucket < buckets.size(); bucket++) {
+    if (buckets[bucket] == 0) continue;
+    int low = bucket == 0 ? 0 : 1 << (bucket - 1), high = bucket == 0 ? 0 : (1 << bucket) - 1;
+    cout << name << "\t" << low << "\t" << high << "\t" << buckets[bucket] << endl;
+  }
+}
+
+/**
+ * The value at the specified percentile of the sorted values.
+ */
+
+static int percentile(const vector<int>& sorted, int percent)
+{
+  return sorted.empty() ? 0 : sorted[min(sorted.size() - 1, sorted.size() * percent / 100)];
+}
+
+static const char *const kUsage =
+  "Usage: imdb-analyze [--seed <n>] [--samples <n>] [--hubs <n>] [--threads <n>] [<data-directory>]";
+
+/**
+ * Function: main
+ * --------------
+ * Defines the entry point for the imdb-analyze executable, which describes the
+ * shape of the graph six-degrees searches, for sizing caches and choosing
+ * landmarks: how skewed the degrees are, which actors make for huge frontiers,
+ * and how long paths typically are.  It compiles the graph, and then
+ *
+ *     counts every actor's credits and distinct co-stars, and every movie's
+ *     cast, spreading the actors across all threads;
+ *     runs a full search out of each of --samples actors (100 by default)
+ *     drawn at random from the largest component, and out of each of the
+ *     --hubs actors (20 by default) with the most co-stars, running as many
+ *     searches at once as there are threads.
+ *
+ * The samples are drawn from a generator seeded with --seed (107 by default),
+ * so runs against the same data are comparable.  --threads defaults to the
+ * number of hardware threads.
+ *
+ * Results go to cout as blocks of tab-separated lines, each under a header
+ * line naming its columns, with a blank line between blocks:
+ *
+ *     summary     the sizes of the graph and its largest component, the
+ *                 percentiles of the degrees, the mean and median distance
+ *                 between a sampled actor and the rest of its component, and
+ *                 bounds on the diameter of the largest component.  Every
+ *                 sampled eccentricity is a lower bound, and twice any of them
+ *                 an upper bound, since any two actors are at most that far
+ *                 apart via the sampled one.
+ *     histogram   the credits, co-stars and cast sizes in power-of-two buckets.
+ *     distance    the fraction of the largest component at each distance from
+ *                 the sampled actors, on average.
+ *     eccentricity the number of sampled actors with each eccentricity.
+ *     hub         the hubs, with their credits, co-stars, eccentricity and mean
+ *                 distance to the rest of their component: hubs that are close
+ *                 to everything make for tight landmark bounds.
+ *
+ * @param argc the number of tokens passed to the command line.
+ * @param argv the C strings making up the full command line.  The last
+ *             argument, if it isn't a flag or a flag's value, names the
+ *             data directory; otherwise the default data directory is used.
+ * @return 0 if the graph was analyzed, and 1 otherwise.
+ */
+
+int main(int argc, const char *argv[])
+{
+  unsigned int seed = 107;
+  int numSamples = 100, numHubs = 20, numThreads = max(1, (int) thread::hardware_concurrency());
+  const char *dataPath = NULL;
+  for (int i = 1; i < argc; i++) {
+    int *count = strcmp(argv[i], "--samples") == 0 ? &numSamples :
+                 strcmp(argv[i], "--hubs") == 0 ? &numHubs :
+                 strcmp(argv[i], "--threads") == 0 ? &numThreads : NULL;
+    if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = strtoul(argv[++i], NULL, 10);
+    else if (count != NULL && i + 1 < argc && atoi(argv[i + 1]) >= (count == &numThreads ? 1 : 0))
+      *count = atoi(argv[++i]);
+    else if (argv[i][0] != '-' && dataPath == NULL) dataPath = argv[i];
+    else {
+      cerr << kUsage << endl;
+      return 1;
+    }
+  }
+
+  const string directory = determinePathToData(dataPath);
+  imdb db(directory);
+  if (!db.good()) {
+    cerr << "Failed to properly initialize the imdb database in " << directory << "." << endl;
+    return 1;
+  }
+  imdbGraph graph(db);
+  int numActors = graph.getNumActors(), numMovies = graph.getNumMovies();
+  if (numActors == 0) {
+    cerr << "There's nothing to analyze in " << directory << "." << endl;
+    return 1;
+  }
+  cerr << "Analyzing " << directory << " (" << numActors << " actors, " << numMovies << " movies) with seed "
+       << seed << " on " << numThreads << " threads." << endl;
+
+  vector<int> credits(numActors), casts(numMovies), costars;
+  for (int i = 0; i < numActors; i++) credits[i] = graph.getNumCredits(i);
+  for (int i = 0; i < numMovies; i++) graph.getCast(i, casts[i]);
+  countCostars(graph, costars, numThreads);
+
+  componentTable components(graph);
+  vector<int> giant;
+  for (int i = 0; i < numActors; i++)
+    if (components.getComponent(i) == 0) giant.push_back(i);
+  mt19937 generator(seed);
+  uniform_int_distribution<int> anyActor(0, giant.size() - 1);
+  vector<sampledSearch> samples(numSamples);
+  for (sampledSearch& s: samples) s.actor = giant[anyActor(generator)];
+
+  numHubs = min(numHubs, numActors);
+  vector<int> hubs(numActors);
+  for (int i = 0; i < numActors; i++) hubs[i] = i;
+  partial_sort(hubs.begin(), hubs.begin() + numHubs, hubs.end(), [&](int a, int b) {
+    return costars[a] != costars[b] ? costars[a] > costars[b] : a < b;
+  });
+  hubs.resize(numHubs);
+  for (int hub: hubs) samples.push_back(sampledSearch{hub, 0, vector<long long>()});
+  runSamples(graph, samples, numThreads);
+
+  // distances and eccentricities come from the random samples alone, so the hubs don't skew them
+  vector<long long> atDistance;
+  vector<int> eccentricities;
+  for (int j = 0; j < numSamples; j++) {
+    const sampledSearch& s = samples[j];
+    if (atDistance.size() < s.atDistance.size()) atDistance.resize(s.atDistance.size(), 0);
+    for (size_t d = 1; d < s.atDistance.size(); d++) atDistance[d] += s.atDistance[d];
+    eccentricities.push_back(s.eccentricity);
+  }
+  long long numPairs = 0, totalDistance = 0, medianDistance = 0;
+  for (size_t d = 1; d < atDistance.size(); d++) {
+    numPairs += atDistance[d];
+    totalDistance += d * atDistance[d];
+  }
+  for (long long seen = 0; medianDistance + 1 < (long long) atDistance.size() && 2 * seen < numPairs; )
+    seen += atDistance[++medianDistance];
+  sort(eccentricities.begin(), eccentricities.end());
+
+  vector<int> sortedCredits(credits), sortedCostars(costars), sortedCasts(casts);
+  sort(sortedCredits.begin(), sortedCredits.end());
+  sort(sortedCostars.begin(), sortedCostars.end());
+  sort(sortedCasts.begin(), sortedCasts.end());
+  cout << "summary\tvalue" << endl;
+  cout << "actors\t" << numActors << endl << "movies\t" << numMovies << endl
+       << "credits\t" << graph.getNumCredits() << endl << "components\t" << components.getNumComponents() << endl
+       << "largest_component\t" << giant.size() << endl;
+  const string degreeNames[] = { "credits", "costars", "cast" };
+  const vector<int> *degrees[] = { &sortedCredits, &sortedCostars, &sortedCasts };
+  for (int k = 0; k < 3; k++) {
+    for (int percent: { 50, 90, 99 })
+      cout << degreeNames[k] << "_p" << percent << "\t" << percentile(*degrees[k], percent) << endl;
+    cout << degreeNames[k] << "_max\t" << (degrees[k]->empty() ? 0 : degrees[k]->back()) << endl;
+  }
+  cout << "samples\t" << numSamples << endl << fixed << setprecision(3)
+       << "mean_distance\t" << (numPairs == 0 ? 0.0 : (double) totalDistance / numPairs) << endl
+       << "median_distance\t" << medianDistance << endl;
+  if (!eccentricities.empty())
+    cout << "diameter_lower\t" << eccentricities.back() << endl << "diameter_upper\t" << 2 * eccentricities.front() << endl;
+
+  cout << endl << "histogram\tlow\thigh\tcount" << endl;
+  reportHistogram("credits", credits);
+  reportHistogram("costars", costars);
+  reportHistogram("cast", casts);
+
+  cout << endl << "distance\tactors\tfraction" << endl;
+  for (size_t d = 1; d < atDistance.size(); d++)
+    cout << d << "\t" << atDistance[d] << "\t" << (double) atDistance[d] / numPairs << endl;
+
+  cout << endl << "eccentricity\tsamples" << endl;
+  for (size_t j = 0; j < eccentricities.size(); ) {
+    size_t k = j;
+    while (k < eccentricities.size() && eccentricities[k] == eccentricities[j]) k++;
+    cout << eccentricities[j] << "\t" << k - j << endl;
+    j = k;
+  }
+
+  cout << endl << "hub\tactor\tcredits\tcostars\teccentricity\tmean_distance" << endl;
+  for (int h = 0; h < numHubs; h++) {
+    const sampledSearch& s = samples[numSamples + h];
+    long long reached = 0, total = 0;
+    for (size_t d = 1; d < s.atDistance.size(); d++) {
+      reached += s.atDistance[d];
+      total += d * s.atDistance[d];
+    }
+    cout << h + 1 << "\t" << graph.getActorName(s.actor) << "\t" << credits[s.actor] << "\t" << costars[s.actor]
+         << "\t" << s.eccentricity << "\t" << (reached == 0 ? 0.0 : (double) total / reached) << endl;
+  }
+  return 0;
+}
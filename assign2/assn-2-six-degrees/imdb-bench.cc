@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "imdb.h"
+#include "imdb-graph.h"
+using namespace std;
+
+/**
+ * The outcome of one benchmark run: how many operations it timed, how many
+ * items they produced between them (credits, cast members, co-stars or legs),
+ * how long they took altogether, and the latency of each one in microseconds.
+ */
+
+struct benchResult {
+  long long items;
+  double seconds;
+  vector<double> latencies;
+};
+
+/**
+ * Times op once for every element of the workload, each call on its own, and
+ * adds up the items it reports.
+ */
+
+template <typename Workload, typename Operation>
+static benchResult timeEach(const vector<Workload>& workload, Operation op)
+{
+  benchResult result = { 0, 0, vector<double>() };
+  result.latencies.reserve(workload.size());
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  for (const Workload& w: workload) {
+    chrono::steady_clock::time_point before = chrono::steady_clock::now();
+    result.items += op(w);
+    result.latencies.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - before).count());
+  }
+  result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  return result;
+}
+
+/**
+ * Publishes one line of results, tab-separated and in the columns named by
+ * the header line main prints first.
+ */
+
+static void report(const string& variant, const string& benchmark, benchResult& result)
+{
+  size_t count = result.latencies.size();
+  sort(result.latencies.begin(), result.latencies.end());
+  double p50 = count == 0 ? 0 : result.latencies[count / 2];
+  double p99 = count == 0 ? 0 : result.latencies[count * 99 / 100];
+  double seconds = max(result.seconds, 1e-9);
+  cout << variant << "\t" << benchmark << "\t" << count << "\t" << result.items << "\t"
+       << fixed << setprecision(6) << result.seconds << "\t" << setprecision(1)
+       << count / seconds << "\t" << result.items / seconds << "\t"
+       << setprecision(3) << p50 << "\t" << p99 << endl;
+}
+
+static const char *const kUsage =
+  "Usage: imdb-bench [--seed <n>] [--lookups <n>] [--expansions <n>] [--queries <n>] [<data-directory>]";
+
+/**
+ * Function: main
+ * --------------
+ * Defines the entry point for the imdb-bench executable, which measures the
+ * imdb and the search that six-degrees runs over it, without any prompting,
+ * so that regressions in either show up as numbers.  The benchmarks are:
+ *
+ *     credits   getCredits on the names of randomly chosen actors
+ *     cast      getCast on randomly chosen movies
+ *     costars   every co-star of randomly chosen actors, read straight out
+ *               of the records (each actor's credits, and each credit's cast)
+ *     distinct  imdb::getCostars on the names of the same actors, which
+ *               counts each distinct co-star once
+ *     graph     compiling the imdbGraph out of the records
+ *     bfs       imdbGraph::findShortestPath between random pairs of actors
+ *
+ * The workload is drawn from a generator seeded with --seed (107 by default),
+ * so runs against the same data are comparable, and it's drawn before any
+ * timing starts.  Every benchmark runs twice: cold, just after imdb::evict has
+ * dropped the data files from the page cache, and then warm.  The search runs
+ * over the graph in memory, so its cold run is cold only in the CPU caches:
+ * it's the graph's compilation that pays for the cold page cache.
+ *
+ * Results go to cout as tab-separated lines, under a header line naming the
+ * columns: the variant, the benchmark, the number of operations timed, the
+ * items they produced, the seconds they took, operations and items per
+ * second, and the p50 and p99 latencies of single operations in microseconds.
+ *
+ * @param argc the number of tokens passed to the command line.
+ * @param argv the C strings making up the full command line.  The last
+ *             argument, if it isn't a flag or a flag's value, names the
+ *             data directory; otherwise the default data directory is used.
+ * @return 0 if the benchmarks ran, and 1 otherwise.
+ */
+
+int main(int argc, const char *argv[])
+{
+  unsigned int seed = 107;
+  int numLookups = 100000, numExpansions = 10000, numQueries = 1000;
+  const char *dataPath = NULL;
+  for (int i = 1; i < argc; i++) {
+    int *count = strcmp(argv[i], "--lookups") == 0 ? &numLookups :
+                 strcmp(argv[i], "--expansions") == 0 ? &numExpansions :
+                 strcmp(argv[i], "--queries") == 0 ? &numQueries : NULL;
+    if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = strtoul(argv[++i], NULL, 10);
+    else if (count != NULL && i + 1 < argc && atoi(argv[i + 1]) >= 0) *count = atoi(argv[++i]);
+    else if (argv[i][0] != '-' && dataPath == NULL) dataPath = argv[i];
+    else {
+      cerr << kUsage << endl;
+      return 1;
+    }
+  }
+
+  const string directory = determinePathToData(dataPath);
+  imdb db(directory);
+  if (!db.good()) {
+    cerr << "Failed to properly initialize the imdb database in " << directory << "." << endl;
+    return 1;
+  }
+  int numActors = db.getNumActors(), numMovies = db.getNumMovies();
+  if (numActors == 0 || numMovies == 0) {
+    cerr << "There's nothing to benchmark in " << directory << "." << endl;
+    return 1;
+  }
+
+  mt19937 generator(seed);
+  uniform_int_distribution<int> anyActor(0, numActors - 1), anyMovie(0, numMovies - 1);
+  vector<string> names;
+  vector<film> films;
+  vector<int> expansions;
+  vector<pair<int, int> > pairs;
+  for (int i = 0; i < numLookups; i++) {
+    names.push_back(string(db.getActor(db.getActorOffset(anyActor(generator))).name));
+    films.push_back(db.getMovie(db.getMovieOffset(anyMovie(generator))).getFilm());
+  }
+  for (int i = 0; i < numExpansions; i++) expansions.push_back(db.getActorOffset(anyActor(generator)));
+  for (int i = 0; i < numQueries; i++) {
+    int source = anyActor(generator);
+    pairs.push_back(make_pair(source, anyActor(generator)));
+  }
+
+  cerr << "Benchmarking " << directory << " (" << numActors << " actors, " << numMovies << " movies, "
+       << (db.converted() ? "converted" : "original") << " data, " << (db.indexed() ? "hash" : "tree")
+       << " lookups) with seed " << seed << "." << endl;
+  cout << "variant\tbenchmark\toperations\titems\tseconds\tops_per_sec\titems_per_sec\tp50_us\tp99_us" << endl;
+  for (const string variant: { "cold", "warm" }) {
+    bool cold = variant == "cold";
+    if (cold && !db.evict()) cerr << "The kernel refused to drop the data from the page cache." << endl;
+    benchResult credits = timeEach(names, [&](const string& name) {
+      vector<film> credits;
+      db.getCredits(name, credits);
+      return credits.size();
+    });
+    report(variant, "credits", credits);
+    benchResult cast = timeEach(films, [&](const film& movie) {
+      vector<string> players;
+      db.getCast(movie, players);
+      return players.size();
+    });
+    report(variant, "cast", cast);
+
+    if (cold) db.evict();
+    benchResult costars = timeEach(expansions, [&](int offset) {
+      imdb::actorRecord actor = db.getActor(offset);
+      long long numCostars = 0;
+      for (int i = 0; i < actor.numCredits; i++) {
+        imdb::movieRecord movie = db.getMovie(actor.credits[i]);
+        for (int j = 0; j < movie.numActors; j++) {
+          db.getActor(movie.cast[j]); // decoded, as any search reporting names would
+          numCostars++;
+        }
+      }
+      return numCostars;
+    });
+    report(variant, "costars", costars);
+
+    if (cold) db.evict();
+    vector<imdb::costar> found;
+    benchResult distinct = timeEach(expansions, [&](int offset) {
+      db.getCostars(db.getActor(offset).name, found);
+      return found.size();
+    });
+    report(variant, "distinct", distinct);
+
+    if (cold) db.evict();
+    imdbGraph *graph = NULL;
+    benchResult compile = timeEach(vector<int>(1), [&](int) {
+      graph = new imdbGraph(db);
+      return graph->getNumCredits();
+    });
+    report(variant, "graph", compile);
+    vector<imdbGraph::link> links;
+    benchResult bfs = timeEach(pairs, [&](const pair<int, int>& query) {
+      graph->findShortestPath(query.first, query.second, links);
+      return links.size();
+    });
+    report(variant, "bfs", bfs);
+    delete graph;
+  }
+  return 0;
+}
@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "imdb.h"
+#include "imdb-graph.h"
+#include "bacon-table.h"
+#include "component-table.h"
+#include "landmark-table.h"
+#include "mapped-file.h"
+#include "name-index.h"
+#include "packed-graph.h"
+using namespace std;
+
+/**
+ * The number of bytes a record takes up in the original layout (see
+ * recordOffsets in imdb.cc): the key (a name and its '\0', plus a year byte
+ * for movies) padded out to an even length, a short count padded out to a
+ * multiple of 4, and then the int offsets.
+ */
+
+static int recordSize(int keyBytes, int count)
+{
+  int size = keyBytes + keyBytes % 2 + sizeof(short);
+  return size + size % 4 + count * sizeof(int);
+}
+
+/**
+ * Lays out one data file in the original layout, in this machine's byte order:
+ * the number of records, their offsets in sorted order, and then the records
+ * themselves in the same order.
+ *
+ * @param keys the key of every record, indexed by id.
+ * @param order the ids in sorted order.
+ * @param lists the ids each record refers to, indexed by id.
+ * @param otherOffsets the offset of every record of the other file, indexed by
+ *                     id, or NULL to only compute this file's offsets.
+ * @param offsets set to the offset of every record in this file, indexed by id.
+ */
+
+static void layOut(const vector<string>& keys, const vector<int>& order, const vector<vector<int> >& lists,
+                   const vector<int> *otherOffsets, vector<int>& offsets, vector<char>& bytes)
+{
+  offsets.resize(keys.size());
+  size_t size = (keys.size() + 1) * sizeof(int);
+  for (int id: order) {
+    offsets[id] = size;
+    size += recordSize(keys[id].size(), lists[id].size());
+  }
+  bytes.assign(size, '\0');
+  int count = keys.size();
+  memcpy(bytes.data(), &count, sizeof(int));
+  for (size_t i = 0; i < order.size(); i++) memcpy(bytes.data() + (i + 1) * sizeof(int), &offsets[order[i]], sizeof(int));
+  if (otherOffsets == NULL) return;
+
+  for (int id: order) {
+    char *record = bytes.data() + offsets[id];
+    int keyBytes = keys[id].size();
+    memcpy(record, keys[id].data(), keyBytes);
+    short numOffsets = lists[id].size();
+    int countAt = keyBytes + keyBytes % 2;
+    memcpy(record + countAt, &numOffsets, sizeof(short));
+    int offsetsAt = countAt + sizeof(short);
+    offsetsAt += offsetsAt % 4;
+    for (int other: lists[id]) {
+      memcpy(record + offsetsAt, &(*otherOffsets)[other], sizeof(int));
+      offsetsAt += sizeof(int);
+    }
+  }
+}
+
+/**
+ * Function: main
+ * --------------
+ * Defines the entry point for the imdb-compact executable, which folds the
+ * delta of a data directory (see imdb::appendToDelta) into a fresh pair of
+ * data files, actordata and moviedata, sorted as the originals are and laid
+ * out the same way, in this machine's byte order.  They're written into the
+ * output directory, which is the data directory itself by default, in which
+ * case the converted data file, the delta, and every index and table built
+ * from the data are removed as well, once both data files have been written,
+ * since none of them match.  (The delta's actors and movies are renumbered,
+ * so a table that still had the right counts would give wrong answers.)
+ * Until then, the directory still holds everything it did, so a failed write
+ * loses nothing.  imdb-convert and imdb-index should then be run again.
+ *
+ * The original layout stores counts as shorts, so compaction fails if any
+ * actor would have, or any movie's cast would come to, more than 32767.
+ *
+ * @param argc the number of tokens passed to the command line.
+ * @param argv the C strings making up the full command line: the data
+ *             directory, and optionally the output directory.
+ * @return 0 if the data files were written, and 1 otherwise.
+ */
+
+int main(int argc, const char *argv[])
+{
+  if (argc < 2 || argc > 3) {
+    cerr << "Usage: imdb-compact <data-directory> [<output-directory>]" << endl;
+    return 1;
+  }
+  const string directory = argv[1];
+  const string output = argc > 2 ? argv[2] : directory;
+  imdb db(directory);
+  if (!db.good()) {
+    cerr << "Failed to properly initialize the imdb database in " << directory << "." << endl;
+    return 1;
+  }
+
+  imdbGraph graph(db);
+  int numActors = graph.getNumActors(), numMovies = graph.getNumMovies();
+  vector<string> actorKeys(numActors), movieKeys(numMovies);
+  vector<film> films(numMovies);
+  vector<vector<int> > credits(numActors), casts(numMovies);
+  for (int i = 0; i < numActors; i++) {
+    actorKeys[i] = string(db.getActorName(i)) + '\0';
+    int count;
+    const int *ids = graph.getCredits(i, count);
+    credits[i].assign(ids, ids + count);
+  }
+  for (int i = 0; i < numMovies; i++) {
+    films[i] = db.getFilm(i);
+    movieKeys[i] = films[i].title + '\0' + (char) graph.getMovieYearByte(i);
+    int count;
+    const int *ids = graph.getCast(i, count);
+    casts[i].assign(ids, ids + count);
+  }
+  for (const vector<vector<int> > *lists: { &credits, &casts }) {
+    for (const vector<int>& list: *lists) {
+      if (list.size() > 32767) {
+        cerr << "The data in " << directory << " has a record with more than 32767 "
+             << (lists == &credits ? "credits" : "cast members") << ", which can't be stored." << endl;
+        return 1;
+      }
+    }
+  }
+
+  vector<int> actorOrder(numActors), movieOrder(numMovies);
+  for (int i = 0; i < numActors; i++) actorOrder[i] = i;
+  for (int i = 0; i < numMovies; i++) movieOrder[i] = i;
+  sort(actorOrder.begin(), actorOrder.end(), [&](int a, int b) { return actorKeys[a] < actorKeys[b]; });
+  sort(movieOrder.begin(), movieOrder.end(), [&](int a, int b) { return films[a] < films[b]; });
+
+  // each file's records hold offsets into the other, so both are laid out before either is filled
+  vector<int> actorOffsets, movieOffsets;
+  vector<char> actorBytes, movieBytes;
+  layOut(actorKeys, actorOrder, credits, NULL, actorOffsets, actorBytes);
+  layOut(movieKeys, movieOrder, casts, &actorOffsets, movieOffsets, movieBytes);
+  layOut(actorKeys, actorOrder, credits, &movieOffsets, actorOffsets, actorBytes);
+
+  if (!mappedFile::writeAtomically(output + "/actordata", actorBytes.data(), actorBytes.size()) ||
+      !mappedFile::writeAtomically(output + "/moviedata", movieBytes.data(), movieBytes.size())) {
+    cerr << "Failed to write the data files into " << output << "." << endl;
+    return 1;
+  }
+  if (output == directory) {
+    for (const char *fileName: { imdb::kDataFileName, imdb::kDeltaFileName, imdb::kActorIndexFileName,
+                                 imdb::kMovieIndexFileName, nameIndex::kFileName, packedGraph::kFileName,
+                                 baconTable::kFileName, landmarkTable::kFileName, componentTable::kFileName })
+      remove((directory + "/" + fileName).c_str());
+  }
+  cout << "Compacted " << numActors << " actors (" << db.getNumDeltaActors() << " from the delta) and "
+       << numMovies << " movies (" << db.getNumDeltaMovies() << " from the delta) into " << output
+       << "; run imdb-convert and imdb-index there again." << endl;
+  return 0;
+}
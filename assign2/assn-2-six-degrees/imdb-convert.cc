@@ -0,0 +1,253 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "imdb.h"
+#include "mapped-file.h"
+using namespace std;
+
+/**
+ * Class: rawFile
+ * --------------
+ * One of the original data files (actordata or moviedata), read into memory
+ * whole, along with whether its byte order is the opposite of this machine's.
+ * The two data sets differ only in byte order, so it's determined from the
+ * file itself: every record is a multiple of 4 bytes long and lies after the
+ * offset table, so, whatever order the records are in, every offset is
+ * word-aligned and points past the table and into the file in only one of
+ * the two orders.
+ */
+
+struct rawFile {
+  vector<char> bytes;
+  bool swapped;
+
+  bool load(const string& fileName);
+  bool offsetsFit() const;
+  int getInt(size_t offset) const;
+  int getShort(size_t offset) const;
+  int getCount() const { return getInt(0); }
+  int getOffset(int index) const { return getInt(4 * (index + 1)); }
+
+  /**
+   * Decodes the record at the specified offset, the same way imdb::getActor and
+   * imdb::getMovie do (see recordOffsets in imdb.cc), except that the count and
+   * the offsets come back in this machine's byte order.  keyExtra is 1 for actor
+   * records and 2 for movie records, whose names are followed by a year byte.
+   *
+   * @return false if the record doesn't lie within the file.
+   */
+
+  bool getRecord(int offset, int keyExtra, string& key, vector<int>& offsets) const;
+};
+
+static unsigned int byteSwap(unsigned int value)
+{
+  return (value >> 24) | ((value >> 8) & 0xff00) | ((value << 8) & 0xff0000) | (value << 24);
+}
+
+bool rawFile::load(const string& fileName)
+{
+  ifstream in(fileName.c_str(), ios::binary);
+  if (!in) return false;
+  bytes.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+  if (bytes.size() < 8) return false;
+  swapped = false;
+  for (int attempt = 0; attempt < 2; attempt++, swapped = !swapped)
+    if (offsetsFit()) return true;
+  return false;
+}
+
+bool rawFile::offsetsFit() const
+{
+  long long count = getCount();
+  if (count < 0 || 4 * (count + 1) > (long long) bytes.size()) return false;
+  for (int i = 0; i < count; i++) {
+    int offset = getOffset(i);
+    if (offset % 4 != 0 || offset < 4 * (count + 1) || (size_t) offset >= bytes.size()) return false;
+  }
+  return true;
+}
+
+int rawFile::getInt(size_t offset) const
+{
+  unsigned int value;
+  memcpy(&value, bytes.data() + offset, sizeof(value));
+  return swapped ? byteSwap(value) : value;
+}
+
+int rawFile::getShort(size_t offset) const
+{
+  unsigned short value;
+  memcpy(&value, bytes.data() + offset, sizeof(value));
+  return (short) (swapped ? (value >> 8) | (value << 8) : value);
+}
+
+bool rawFile::getRecord(int offset, int keyExtra, string& key, vector<int>& offsets) const
+{
+  if (offset < 0 || (size_t) offset >= bytes.size()) return false;
+  const char *record = bytes.data() + offset;
+  const char *nameEnd = (const char *) memchr(record, '\0', bytes.size() - offset);
+  if (nameEnd == NULL) return false;
+  size_t nameBytes = nameEnd - record + keyExtra;
+  if (offset + nameBytes > bytes.size()) return false;
+  key.assign(record, nameBytes);
+  if (nameBytes % 2 != 0) nameBytes++;
+  size_t countAt = offset + nameBytes;
+  if (countAt + 2 > bytes.size()) return false;
+  int count = getShort(countAt);
+  size_t offsetsStart = nameBytes + 2;
+  if (offsetsStart % 4 != 0) offsetsStart += 2;
+  if (count < 0 || offset + offsetsStart + 4 * (size_t) count > bytes.size()) return false;
+  offsets.resize(count);
+  for (int i = 0; i < count; i++) offsets[i] = getInt(offset + offsetsStart + 4 * i);
+  return true;
+}
+
+/**
+ * Maps offsets into a raw file to the positions of the records at those
+ * offsets within its offset table, via a sorted copy of the table.
+ */
+
+static vector<pair<int, int> > sortedOffsets(const rawFile& raw)
+{
+  vector<pair<int, int> > sorted(raw.getCount());
+  for (int i = 0; i < raw.getCount(); i++) sorted[i] = make_pair(raw.getOffset(i), i);
+  sort(sorted.begin(), sorted.end());
+  return sorted;
+}
+
+static int positionOf(const vector<pair<int, int> >& sorted, int offset)
+{
+  vector<pair<int, int> >::const_iterator found = lower_bound(sorted.begin(), sorted.end(), make_pair(offset, 0));
+  return found == sorted.end() || found->first != offset ? -1 : found->second;
+}
+
+/**
+ * Works out where each record of the specified raw file lands within its
+ * converted section, in the order of the raw file's offset table: a record
+ * is its key padded out to a multiple of 4, an int count, and the offsets.
+ */
+
+static bool layoutSection(const rawFile& raw, int keyExtra, vector<int>& newOffsets)
+{
+  int count = raw.getCount();
+  newOffsets.resize(count);
+  size_t size = 4 * (count + 1);
+  string key;
+  vector<int> offsets;
+  for (int i = 0; i < count; i++) {
+    if (!raw.getRecord(raw.getOffset(i), keyExtra, key, offsets)) return false;
+    if (size > 0x7fffffff) return false;
+    newOffsets[i] = size;
+    size = ((size + key.size() + 3) & ~3) + 4 * (offsets.size() + 1);
+  }
+  return true;
+}
+
+/**
+ * Builds the converted section for the specified raw file, translating each of
+ * its records' offsets into the other raw file into offsets into the other
+ * converted section.
+ */
+
+static bool writeSection(const rawFile& raw, int keyExtra, const vector<int>& newOffsets,
+                         const vector<pair<int, int> >& otherPositions, const vector<int>& otherNewOffsets,
+                         vector<char>& section)
+{
+  int count = raw.getCount();
+  section.assign(4 * (count + 1), '\0');
+  memcpy(section.data(), &count, sizeof(int));
+  memcpy(section.data() + 4, newOffsets.data(), count * sizeof(int));
+  string key;
+  vector<int> offsets;
+  for (int i = 0; i < count; i++) {
+    raw.getRecord(raw.getOffset(i), keyExtra, key, offsets);
+    section.insert(section.end(), key.begin(), key.end());
+    section.resize((section.size() + 3) & ~3, '\0');
+    offsets.insert(offsets.begin(), offsets.size());
+    for (size_t j = 1; j < offsets.size(); j++) {
+      int position = positionOf(otherPositions, offsets[j]);
+      if (position == -1) return false;
+      offsets[j] = otherNewOffsets[position];
+    }
+    section.insert(section.end(), (const char *) offsets.data(), (const char *) (offsets.data() + offsets.size()));
+  }
+  return true;
+}
+
+/**
+ * Function: main
+ * --------------
+ * Defines the entry point for the imdb-convert executable, which rewrites
+ * the actordata and moviedata files of either data set (little-endian or
+ * big-endian) into a single converted data file in this machine's byte order,
+ * which the imdb then maps in their place.  See imdb::kDataFileName.
+ *
+ * @param argc the number of tokens passed to the command line.
+ * @param argv the C strings making up the full command line.  argv[1] names
+ *             the directory housing the original data files, and argv[2], if
+ *             present, the directory the converted file should be written to
+ *             (by default, the same directory).
+ * @return 0 if the converted file was written, and 1 otherwise.
+ */
+
+int main(int argc, const char *argv[])
+{
+  if (argc < 2) {
+    cerr << "Usage: " << argv[0] << " <data directory> [output directory]" << endl;
+    return 1;
+  }
+  const string directory = argv[1];
+  const string output = argc > 2 ? argv[2] : argv[1];
+  rawFile actors, movies;
+  if (!actors.load(directory + "/actordata") || !movies.load(directory + "/moviedata")) {
+    cerr << "Couldn't read actordata and moviedata out of " << directory << "." << endl;
+    return 1;
+  }
+
+  vector<int> newActorOffsets, newMovieOffsets;
+  vector<char> actorSection, movieSection;
+  if (!layoutSection(actors, 1, newActorOffsets) || !layoutSection(movies, 2, newMovieOffsets) ||
+      !writeSection(actors, 1, newActorOffsets, sortedOffsets(movies), newMovieOffsets, actorSection) ||
+      !writeSection(movies, 2, newMovieOffsets, sortedOffsets(actors), newActorOffsets, movieSection)) {
+    cerr << "The data files in " << directory << " are malformed." << endl;
+    return 1;
+  }
+
+  imdb::dataHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = imdb::kDataMagic;
+  header.version = imdb::kDataVersion;
+  header.byteOrder = imdb::kByteOrderMark;
+  header.numActors = actors.getCount();
+  header.numMovies = movies.getCount();
+  header.actorSection = imdb::kDataAlignment;
+  header.actorSectionSize = actorSection.size();
+  header.movieSection = (header.actorSection + header.actorSectionSize + imdb::kDataAlignment - 1) &
+                        ~(long long) (imdb::kDataAlignment - 1);
+  header.movieSectionSize = movieSection.size();
+
+  vector<char> file(header.movieSection + header.movieSectionSize, '\0');
+  memcpy(file.data(), &header, sizeof(header));
+  memcpy(file.data() + header.actorSection, actorSection.data(), actorSection.size());
+  memcpy(file.data() + header.movieSection, movieSection.data(), movieSection.size());
+  const string fileName = output + "/" + imdb::kDataFileName;
+  if (!mappedFile::writeAtomically(fileName, file.data(), file.size())) {
+    cerr << "Failed to write " << fileName << "." << endl;
+    return 1;
+  }
+
+  imdb db(output);
+  if (!db.good() || !db.converted() || db.getNumActors() != header.numActors) {
+    cerr << "The converted data in " << fileName << " doesn't read back." << endl;
+    return 1;
+  }
+  cout << "Converted " << header.numActors << " actors and " << header.numMovies << " movies from "
+       << (actors.swapped ? "foreign" : "native") << "-endian data into " << fileName
+       << " (" << file.size() << " bytes)." << endl;
+  return 0;
+}
@@ -0,0 +1,86 @@
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "imdb.h"
+using namespace std;
+
+/**
+ * Parses one line of input, a movie's title and year followed by the names of
+ * some of its cast, all separated by tabs, as in
+ *
+ *     The Dark Knight (2008)\tChristian Bale\tHeath Ledger
+ *
+ * @return false if the line doesn't start with a title and a year in parentheses.
+ */
+
+static bool parseEntry(const string& line, imdb::deltaEntry& entry)
+{
+  istringstream fields(line);
+  string name;
+  if (!getline(fields, name, '\t')) return false;
+  size_t open = name.rfind(" (");
+  int year;
+  if (open == string::npos || name.back() != ')' || sscanf(name.c_str() + open + 2, "%d", &year) != 1) return false;
+  entry.movie.title = name.substr(0, open);
+  entry.movie.year = year;
+  entry.cast.clear();
+  while (getline(fields, name, '\t'))
+    if (!name.empty()) entry.cast.push_back(name);
+  return true;
+}
+
+/**
+ * Function: main
+ * --------------
+ * Defines the entry point for the imdb-delta executable, which adds movies to
+ * a data directory without rebuilding its data files: it reads one movie per
+ * line from standard input (see parseEntry) and appends them all to the
+ * directory's delta in one go (see imdb::appendToDelta).  Blank lines are
+ * skipped, and nothing is appended if any other line is malformed.  Every imdb
+ * opened on the directory from then on sees the new movies; tables derived
+ * from the graph notice that the data has changed, and are rebuilt.
+ *
+ * @param argc the number of tokens passed to the command line.
+ * @param argv the C strings making up the full command line.  argv[1],
+ *             if present, names the data directory; otherwise the
+ *             default data directory is used.
+ * @return 0 if the movies were appended, and 1 otherwise.
+ */
+
+int main(int argc, const char *argv[])
+{
+  if (argc > 2) {
+    cerr << "Usage: imdb-delta [<data-directory>] < movies" << endl;
+    return 1;
+  }
+  const string directory = determinePathToData(argc > 1 ? argv[1] : NULL);
+  imdb db(directory);
+  if (!db.good()) {
+    cerr << "Failed to properly initialize the imdb database in " << directory << "." << endl;
+    return 1;
+  }
+
+  vector<imdb::deltaEntry> entries;
+  size_t numCredits = 0;
+  string line;
+  for (int lineNumber = 1; getline(cin, line); lineNumber++) {
+    if (line.empty()) continue;
+    imdb::deltaEntry entry;
+    if (!parseEntry(line, entry)) {
+      cerr << "Line " << lineNumber << " doesn't start with a title and a year, as in \"Title (2008)\"." << endl;
+      return 1;
+    }
+    numCredits += entry.cast.size();
+    entries.push_back(entry);
+  }
+
+  if (!db.appendToDelta(directory, entries)) {
+    cerr << "Failed to append to the delta in " << directory << "." << endl;
+    return 1;
+  }
+  cout << "Appended " << entries.size() << " movies with " << numCredits << " credits to "
+       << directory << "/" << imdb::kDeltaFileName << "." << endl;
+  return 0;
+}
@@ -0,0 +1,255 @@
+#include "imdb-graph.h"
+#include "landmark-table.h"
+#include "visited-set.h"
+#include "search-filter.h"
+#include "search-stats.h"
+#include "parallel-bfs.h"
+#include <algorithm>
+using namespace std;
+
+imdbGraph::imdbGraph(const imdb& db) : db(db)
+{
+  int numDataActors = db.getNumActors(), numDataMovies = db.getNumMovies();
+  numActors = numDataActors + db.getNumDeltaActors();
+  numMovies = numDataMovies + db.getNumDeltaMovies();
+
+  // credits are stored as moviedata byte offsets, so first build a sorted
+  // (offset, id) table to translate them into movie ids.
+  vector<pair<int, int> > movieIds(numDataMovies);
+  movieYears.resize(numMovies);
+  for (int i = 0; i < numDataMovies; i++) {
+    movieIds[i] = make_pair(db.getMovieOffset(i), i);
+    movieYears[i] = db.getMovie(db.getMovieOffset(i)).yearByte;
+  }
+  for (int i = numDataMovies; i < numMovies; i++) movieYears[i] = db.getFilm(i).year - 1900;
+  sort(movieIds.begin(), movieIds.end());
+
+  // the delta's credits are sorted by actor, so they're merged in as each actor is reached
+  const vector<pair<int, int> >& deltaCredits = db.getDeltaCredits();
+  vector<pair<int, int> >::const_iterator delta = deltaCredits.begin();
+  actorCreditStart.resize(numActors + 1);
+  vector<int> castSizes(numMovies, 0);
+  for (int i = 0; i < numActors; i++) {
+    actorCreditStart[i] = actorCredits.size();
+    if (i < numDataActors) {
+      imdb::actorRecord actor = db.getActor(db.getActorOffset(i));
+      for (int j = 0; j < actor.numCredits; j++) {
+        vector<pair<int, int> >::const_iterator found =
+          lower_bound(movieIds.begin(), movieIds.end(), make_pair(actor.credits[j], 0));
+        actorCredits.push_back(found->second);
+        castSizes[found->second]++;
+      }
+    }
+    for (; delta != deltaCredits.end() && delta->first == i; delta++) {
+      actorCredits.push_back(delta->second);
+      castSizes[delta->second]++;
+    }
+    sort(actorCredits.begin() + actorCreditStart[i], actorCredits.end());
+  }
+  actorCreditStart[numActors] = actorCredits.size();
+
+  // the casts are the transpose of the credits, so they come out sorted by actor id
+  movieCastStart.resize(numMovies + 1);
+  movieCastStart[0] = 0;
+  for (int i = 0; i < numMovies; i++) movieCastStart[i + 1] = movieCastStart[i] + castSizes[i];
+  movieCast.resize(actorCredits.size());
+  vector<int> fill(movieCastStart.begin(), movieCastStart.end() - 1);
+  for (int i = 0; i < numActors; i++)
+    for (int j = actorCreditStart[i]; j < actorCreditStart[i + 1]; j++)
+      movieCast[fill[actorCredits[j]]++] = i;
+}
+
+int imdbGraph::getActorId(const string& player, searchStats *stats) const
+{
+  return db.findActor(player, stats);
+}
+
+string imdbGraph::getActorName(int actor) const
+{
+  return string(db.getActorName(actor));
+}
+
+film imdbGraph::getMovie(int movie) const
+{
+  return db.getFilm(movie);
+}
+
+/**
+ * Per-query state for one side of the bidirectional search.  visitedActors and
+ * visitedMovies hold everything reached from this side's origin so far, and
+ * parentMovie and parentActor record how each visited actor was first reached
+ * (they're only meaningful for visited actors, so they're never cleared).
+ * frontier holds the actors discovered during the most recent level, and depth
+ * is the number of movies between them and the origin.  goal is the other side's
+ * origin's row of landmark distances, when the search is being pruned.
+ *
+ * Each thread keeps one pair of sides and reuses them for every query it
+ * answers, so nothing proportional to the size of the graph is allocated or
+ * cleared per query.
+ */
+
+static const int kOrigin = -1;
+
+struct imdbGraph::searchSide {
+  visitedSet visitedActors;
+  visitedSet visitedMovies;
+  vector<int> parentMovie;
+  vector<int> parentActor;
+  vector<int> frontier;
+  vector<int> next;
+  int depth;
+  const unsigned char *goal;
+
+  void reset(int origin, int numActors, int numMovies) {
+    visitedActors.reset(numActors);
+    visitedMovies.reset(numMovies);
+    if ((int) parentMovie.size() < numActors) {
+      parentMovie.resize(numActors);
+      parentActor.resize(numActors);
+    }
+    visitedActors.insert(origin);
+    parentMovie[origin] = kOrigin;
+    frontier.assign(1, origin);
+    depth = 0;
+    goal = NULL;
+  }
+};
+
+/**
+ * Expands one full level of the specified side, replacing its frontier with the
+ * actors discovered along the way.  Because whole levels are expanded at a time,
+ * the first actor found that the other side has already reached lies on a shortest
+ * path, so we return it immediately.
+ *
+ * Actors that can't lie on a path of at most upper movies are marked as visited
+ * but left out of the next frontier.  Every actor on a shortest path survives
+ * that test, so the two sides still meet at the right depth; and any meeting
+ * found through a pruned actor before then is just as short.  Movies and actors
+ * the filter doesn't allow are never reached at all, and so never count as
+ * expanded.
+ *
+ * @return the id of the actor where the two sides met, or -1 if they didn't.
+ */
+
+int imdbGraph::expandLevel(searchSide& side, const searchSide& other, const landmarkTable *landmarks,
+                           int upper, const searchFilter *filter, searchStats *stats) const
+{
+  vector<int>& next = side.next;
+  next.clear();
+  side.depth++;
+  if (stats != NULL) {
+    stats->actorsExpanded += side.frontier.size();
+    stats->frontierSizes.push_back(side.frontier.size());
+  }
+  for (int player: side.frontier) {
+    for (int i = actorCreditStart[player]; i < actorCreditStart[player + 1]; i++) {
+      int movie = actorCredits[i];
+      if (!side.visitedMovies.insert(movie)) continue;
+      if (filter != NULL && !filter->allowsMovie(movie)) continue;
+      if (stats != NULL) stats->moviesExpanded++;
+      for (int j = movieCastStart[movie]; j < movieCastStart[movie + 1]; j++) {
+        int actor = movieCast[j];
+        // excluded actors are never marked as visited, or the other side could meet at one
+        if (filter != NULL && !filter->allowsActor(actor)) continue;
+        if (!side.visitedActors.insert(actor)) continue;
+        side.parentMovie[actor] = movie;
+        side.parentActor[actor] = player;
+        if (other.visitedActors.contains(actor)) return actor;
+        if (landmarks != NULL && side.depth + landmarks->getLowerBound(actor, side.goal) > upper) continue;
+        next.push_back(actor);
+      }
+    }
+  }
+  side.frontier.swap(next);
+  return -1;
+}
+
+bool imdbGraph::findShortestPath(int source, int target, vector<link>& links, const landmarkTable *landmarks,
+                                 const searchFilter *filter, searchStats *stats) const
+{
+  links.clear();
+  if (filter != NULL && (!filter->allowsActor(source) || !filter->allowsActor(target))) return false;
+  if (source == target) return true;
+
+  int lower, upper = landmarkTable::kUnbounded;
+  if (landmarks != NULL && !landmarks->getBounds(source, target, lower, upper)) return false;
+  if (upper == landmarkTable::kUnbounded || filter != NULL) landmarks = NULL;
+
+  static thread_local searchSide sourceSide, targetSide;
+  sourceSide.reset(source, numActors, numMovies);
+  targetSide.reset(target, numActors, numMovies);
+  if (landmarks != NULL) {
+    sourceSide.goal = landmarks->getDistances(target);
+    targetSide.goal = landmarks->getDistances(source);
+  }
+  while (!sourceSide.frontier.empty() && !targetSide.frontier.empty()) {
+    int meeting;
+    if (sourceSide.frontier.size() <= targetSide.frontier.size()) {
+      meeting = expandLevel(sourceSide, targetSide, landmarks, upper, filter, stats);
+    } else {
+      meeting = expandLevel(targetSide, sourceSide, landmarks, upper, filter, stats);
+    }
+    if (meeting == -1) continue;
+
+    for (int actor = meeting; actor != source; actor = sourceSide.parentActor[actor])
+      links.push_back({sourceSide.parentMovie[actor], actor});
+    std::reverse(links.begin(), links.end());
+    for (int actor = meeting; actor != target; actor = targetSide.parentActor[actor])
+      links.push_back({targetSide.parentMovie[actor], targetSide.parentActor[actor]});
+    return true;
+  }
+  return false;
+}
+
+path imdbGraph::decodePath(const imdb& db, int source, const vector<link>& links, searchStats *stats)
+{
+  path result(string(db.getActorName(source)));
+  for (const link& l: links)
+    result.addConnection(db.getFilm(l.movie), string(db.getActorName(l.actor)));
+  if (stats != NULL) {
+    // only records in the data files are mapped: the delta's were decoded when it was loaded
+    auto actorSize = [&](int actor) { return actor < db.getNumActors() ? db.getActor(db.getActorOffset(actor)).getSize() : 0; };
+    auto movieSize = [&](int movie) { return movie < db.getNumMovies() ? db.getMovie(db.getMovieOffset(movie)).getSize() : 0; };
+    stats->bytesTouched += actorSize(source);
+    for (const link& l: links) stats->bytesTouched += movieSize(l.movie) + actorSize(l.actor);
+  }
+  return result;
+}
+
+/**
+ * The compressed sparse row arrays, seen as an adjacency (see parallel-bfs.h).
+ */
+
+struct csrAdjacency {
+  const vector<int>& start;
+  const vector<int>& neighbours;
+
+  int getNumNodes() const { return start.size() - 1; }
+  long long getNumEdges() const { return neighbours.size(); }
+  int getDegree(int node) const { return start[node + 1] - start[node]; }
+
+  template <typename Visit>
+  void forEachNeighbour(int node, Visit visit) const {
+    for (int i = start[node]; i < start[node + 1]; i++)
+      if (visit(neighbours[i])) return;
+  }
+};
+
+void imdbGraph::breadthFirstSearch(int source, int target, int numThreads,
+                                   vector<int>& distances, vector<link>& parents) const
+{
+  parallelBreadthFirstSearch(csrAdjacency{actorCreditStart, actorCredits},
+                             csrAdjacency{movieCastStart, movieCast},
+                             source, target, numThreads, distances, parents);
+}
+
+bool imdbGraph::tracePath(const vector<int>& distances, const vector<link>& parents,
+                          int target, vector<link>& links)
+{
+  links.clear();
+  if (target < 0 || distances[target] == -1) return false;
+  for (int actor = target; distances[actor] > 0; actor = parents[actor].actor)
+    links.push_back({parents[actor].movie, actor});
+  std::reverse(links.begin(), links.end());
+  return true;
+}
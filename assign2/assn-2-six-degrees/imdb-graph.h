@@ -0,0 +1,266 @@
+#ifndef __imdb_graph__
+#define __imdb_graph__
+
+#include "imdb.h"
+#include "path.h"
+#include <string>
+#include <vector>
+using namespace std;
+
+class landmarkTable;
+class searchFilter;
+struct searchStats;
+
+/**
+ * Class: imdbGraph
+ * ----------------
+ * The imdbGraph is a compiled, read-only copy of the actor/movie relationships
+ * housed by an imdb.  Actors and movies are identified by dense integer ids
+ * (their positions within the sorted offset tables at the front of actordata
+ * and moviedata), and the bipartite graph connecting them is stored in
+ * compressed sparse row form: the credits of actor i are the movie ids
+ * actorCredits[actorCreditStart[i]] up to (but excluding)
+ * actorCredits[actorCreditStart[i + 1]], and casts are stored the same way.
+ *
+ * Building the graph walks every record once, but thereafter searches never
+ * touch a string: names are only decoded (via the backing imdb) for the
+ * actors and movies on a final path.  Actors and movies that are only in the
+ * imdb's delta follow the rest, with the ids the imdb gives them, and the
+ * delta's credits are merged in with the others.
+ */
+
+class imdbGraph {
+
+ public:
+
+  /**
+   * Convenience struct: link
+   * ------------------------
+   * One leg of a path through the graph: the movie shared with the
+   * previous actor, and the actor reached through it.
+   */
+
+  struct link {
+    int movie;
+    int actor;
+  };
+
+  /**
+   * Constructor: imdbGraph
+   * ----------------------
+   * Compiles the graph from the records of the specified imdb, which
+   * must be good() and must outlive the graph, since names are decoded
+   * straight out of its memory maps.
+   *
+   * @param db the imdb whose actors and movies should be compiled.
+   */
+
+  imdbGraph(const imdb& db);
+
+  /**
+   * Methods: getNumActors
+   *          getNumMovies
+   * ---------------------
+   * Self-explanatory.  Actor ids range from 0 to getNumActors() - 1,
+   * and movie ids range from 0 to getNumMovies() - 1.
+   */
+
+  int getNumActors() const { return numActors; }
+  int getNumMovies() const { return numMovies; }
+
+  /**
+   * Method: getNumCredits
+   * ---------------------
+   * Returns the total number of (actor, movie) credits, which is also the
+   * number of edges in the graph.  Given an actor id, returns the number
+   * of movies that actor appears in instead.
+   */
+
+  int getNumCredits() const { return actorCredits.size(); }
+  int getNumCredits(int actor) const { return actorCreditStart[actor + 1] - actorCreditStart[actor]; }
+
+  /**
+   * Method: getDataSize
+   * -------------------
+   * Returns imdb::getDataSize of the imdb the graph was built from.  Tables
+   * derived from the graph record it, along with the numbers of actors,
+   * movies and credits, so that they can tell when they've gone stale: data
+   * that's been rebuilt or compacted can keep every count and still number
+   * its actors differently.
+   */
+
+  size_t getDataSize() const { return db.getDataSize(); }
+
+  /**
+   * Methods: getCredits
+   *          getCast
+   * ------------------
+   * Return the ids of the movies the specified actor appears in, or of the
+   * actors appearing in the specified movie, in increasing order, setting
+   * count to the number of them.  The ids are owned by the graph.
+   */
+
+  const int *getCredits(int actor, int& count) const {
+    count = actorCreditStart[actor + 1] - actorCreditStart[actor];
+    return actorCredits.data() + actorCreditStart[actor];
+  }
+
+  const int *getCast(int movie, int& count) const {
+    count = movieCastStart[movie + 1] - movieCastStart[movie];
+    return movieCast.data() + movieCastStart[movie];
+  }
+
+  /**
+   * Methods: getMovieYearByte
+   *          getMovieYearBytes
+   * --------------------------
+   * Return the year byte of the specified movie (the year it was released
+   * less 1900, exactly as it's stored in moviedata, and read as a char just
+   * as imdb::movieRecord::getYear reads it), or the dense array of every
+   * movie's year byte, indexed by movie id, which is owned by the graph.
+   */
+
+  int getMovieYearByte(int movie) const { return movieYears[movie]; }
+  const char *getMovieYearBytes() const { return movieYears.data(); }
+
+  /**
+   * Method: getActorId
+   * ------------------
+   * Maps the name of an actor or actress to its integer id.
+   *
+   * @param player the name of the actor or actress being queried.
+   * @param stats counts the lookup (see imdb::findActor), unless it's NULL.
+   * @return the id of the specified actor/actress, or -1 if the
+   *         actor/actress isn't in the database.
+   */
+
+  int getActorId(const string& player, searchStats *stats = NULL) const;
+
+  /**
+   * Methods: getActorName
+   *          getMovie
+   * -----------------
+   * Decodes the name of the actor or the title and year of the movie
+   * with the specified id.  These are the only graph methods that
+   * build strings.
+   */
+
+  string getActorName(int actor) const;
+  film getMovie(int movie) const;
+
+  /**
+   * Method: findShortestPath
+   * ------------------------
+   * Runs a bidirectional breadth-first search between the two actors,
+   * always expanding one full level of the side with the smaller frontier,
+   * and stopping as soon as the two sides meet.
+   *
+   * If a landmarkTable is supplied, its bounds are used twice over: actors
+   * the landmarks prove to be disconnected are rejected without any search
+   * at all, and an actor that couldn't possibly lie on a path no longer than
+   * the landmarks' upper bound (the distance to it plus the lower bound on the
+   * distance from it to the far side exceeds it) is never expanded.
+   *
+   * If a searchFilter is supplied, the path only passes through the movies and
+   * actors it allows, and is the shortest such path.  Since the filtered graph
+   * is a subgraph of the full one, the landmarks' lower bounds still hold, but
+   * their upper bound doesn't, so a filtered search is never pruned.
+   *
+   * @param source the id of the actor/actress the path should start with.
+   * @param target the id of the actor/actress the path should end with.
+   * @param links populated with the legs leading from source to target if
+   *              a path exists, and cleared otherwise.
+   * @param landmarks the landmarks used to prune the search, or NULL.
+   * @param filter the movies and actors the path may use, or NULL for all of them.
+   * @param stats counts the actors and movies expanded and the size of every
+   *              frontier expanded, unless it's NULL.
+   * @return true if and only if a path between the two actors exists.
+   */
+
+  bool findShortestPath(int source, int target, vector<link>& links,
+                        const landmarkTable *landmarks = NULL, const searchFilter *filter = NULL,
+                        searchStats *stats = NULL) const;
+
+  /**
+   * Method: decodePath
+   * ------------------
+   * Decodes the legs produced by findShortestPath into a full path.  Actor and
+   * movie ids are the imdb's own indexes, so legs can also be decoded straight
+   * out of the imdb, without a graph, which is what the static version does.
+   *
+   * @param source the id of the actor/actress the path starts with.
+   * @param links the legs produced by findShortestPath.
+   * @param stats counts the bytes of the records decoded, unless it's NULL.
+   * @return the path, with every actor name and movie decoded.
+   */
+
+  path decodePath(int source, const vector<link>& links, searchStats *stats = NULL) const {
+    return decodePath(db, source, links, stats);
+  }
+
+  static path decodePath(const imdb& db, int source, const vector<link>& links, searchStats *stats = NULL);
+
+  /**
+   * Method: breadthFirstSearch
+   * --------------------------
+   * Runs a level-synchronous breadth-first search out of the specified actor,
+   * alternating between levels of movies and levels of actors.  Each level is
+   * expanded in parallel, and is either expanded top-down (every frontier node
+   * claims its unvisited neighbours) or bottom-up (every unvisited node looks
+   * for a neighbour in the frontier), whichever the sizes of the frontier and
+   * the unexplored part of the graph suggest is cheaper.  Visited and frontier
+   * sets are bitmaps.  Bottom-up steps pay off around hubs, where a top-down
+   * step would mostly re-check nodes that have already been visited.
+   *
+   * @param source the id of the actor/actress the search starts from.
+   * @param target the id of an actor/actress to stop at as soon as it's reached,
+   *               or -1 to search the entire component of source.
+   * @param numThreads the number of threads each level is spread across.
+   * @param distances resized to getNumActors() and populated with the number of
+   *                  movies between source and every actor reached, and -1 for
+   *                  every actor that wasn't.
+   * @param parents resized to getNumActors(), and populated so that parents[i]
+   *                is the movie and the actor through which actor i was reached.
+   *                When several threads reach an actor in the same level, any
+   *                one of them may win, so the parents, and the paths traced
+   *                through them, can differ from run to run; each is still a
+   *                shortest one.
+   */
+
+  void breadthFirstSearch(int source, int target, int numThreads,
+                          vector<int>& distances, vector<link>& parents) const;
+
+  /**
+   * Method: tracePath
+   * -----------------
+   * Builds the legs from the source of a breadthFirstSearch out to the
+   * specified actor, using the parents that search populated.
+   *
+   * @return true if and only if the search reached the target.
+   */
+
+  static bool tracePath(const vector<int>& distances, const vector<link>& parents,
+                        int target, vector<link>& links);
+
+ private:
+  const imdb& db;
+  int numActors;
+  int numMovies;
+
+  // compressed sparse row adjacency, in both directions
+  vector<int> actorCreditStart;
+  vector<int> actorCredits;
+  vector<int> movieCastStart;
+  vector<int> movieCast;
+  vector<char> movieYears;
+
+  struct searchSide;
+  int expandLevel(searchSide& side, const searchSide& other, const landmarkTable *landmarks,
+                  int upper, const searchFilter *filter, searchStats *stats) const;
+
+  // marked as private so graphs can't be copy constructed or reassigned (same as imdb).
+  imdbGraph(const imdbGraph& original);
+  imdbGraph& operator=(const imdbGraph& rhs);
+};
+
+#endif
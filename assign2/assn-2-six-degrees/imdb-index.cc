@@ -0,0 +1,44 @@
+#include <iostream>
+#include <string>
+#include "imdb.h"
+#include "name-index.h"
+using namespace std;
+
+/**
+ * Function: main
+ * --------------
+ * Defines the entry point for the imdb-index executable, which
+ * precomputes the optional index files that live next to the
+ * actordata and moviedata files and speed up every imdb opened
+ * on that directory thereafter, along with the name index that
+ * completes and corrects names (see nameIndex).
+ *
+ * @param argc the number of tokens passed to the command line.
+ * @param argv the C strings making up the full command line.  argv[1],
+ *             if present, names the data directory; otherwise the
+ *             default data directory is used.
+ * @return 0 if the indexes were written, and 1 otherwise.
+ */
+
+int main(int argc, const char *argv[])
+{
+  const string directory = determinePathToData(argc > 1 ? argv[1] : NULL);
+  imdb db(directory);
+  if (!db.good()) {
+    cerr << "Failed to properly initialize the imdb database in " << directory << "." << endl;
+    return 1;
+  }
+
+  if (!db.writeIndexes(directory)) {
+    cerr << "Failed to write the hash indexes into " << directory << "." << endl;
+    return 1;
+  }
+  nameIndex names(db);
+  if (!names.save(directory + "/" + nameIndex::kFileName)) {
+    cerr << "Failed to write the name index into " << directory << "." << endl;
+    return 1;
+  }
+  cout << "Indexed " << db.getNumActors() << " actors and " << db.getNumMovies()
+       << " movies in " << directory << "." << endl;
+  return 0;
+}
@@ -0,0 +1,50 @@
+#include <iostream>
+#include <string>
+#include "imdb.h"
+#include "imdb-graph.h"
+#include "packed-graph.h"
+using namespace std;
+
+/**
+ * Function: main
+ * --------------
+ * Defines the entry point for the imdb-pack executable, which compiles
+ * the actordata and moviedata files into the compressed graph file that
+ * lives next to them (see packedGraph), and reports how much smaller the
+ * compressed graph is than the files it was built from.
+ *
+ * @param argc the number of tokens passed to the command line.
+ * @param argv the C strings making up the full command line.  argv[1],
+ *             if present, names the data directory; otherwise the
+ *             default data directory is used.
+ * @return 0 if the graph was written, and 1 otherwise.
+ */
+
+int main(int argc, const char *argv[])
+{
+  const string directory = determinePathToData(argc > 1 ? argv[1] : NULL);
+  imdb db(directory);
+  if (!db.good()) {
+    cerr << "Failed to properly initialize the imdb database in " << directory << "." << endl;
+    return 1;
+  }
+
+  imdbGraph graph(db);
+  const string fileName = directory + "/" + packedGraph::kFileName;
+  if (!packedGraph::write(graph, fileName)) {
+    cerr << "Failed to write the packed graph to " << fileName << "." << endl;
+    return 1;
+  }
+
+  packedGraph packed(db, fileName);
+  if (!packed.good()) {
+    cerr << "The packed graph written to " << fileName << " doesn't read back." << endl;
+    return 1;
+  }
+  size_t dataSize = mappedFile(directory + "/actordata").size() + mappedFile(directory + "/moviedata").size();
+  size_t arraySize = (graph.getNumActors() + graph.getNumMovies() + 2 + 2LL * graph.getNumCredits()) * sizeof(int);
+  cout << "Packed " << graph.getNumActors() << " actors, " << graph.getNumMovies() << " movies and "
+       << graph.getNumCredits() << " credits into " << packed.getSize() << " bytes (actordata and moviedata: "
+       << dataSize << " bytes, uncompressed graph: " << arraySize << " bytes)." << endl;
+  return 0;
+}
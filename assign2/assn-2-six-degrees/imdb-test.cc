@@ -1,8 +1,8 @@
+#include <algorithm>
 #include <iostream>
 #include <iomanip> // for setw formatter
-#include <map>
-#include <set>
 #include <string>
+#include <string_view>
 #include "imdb.h"
 using namespace std;
 
@@ -73,43 +73,37 @@ static void listMovies(const string& player, const vector<film>& credits)
 /**
  * Function: listCostars
  * ---------------------
- * Builds up the list of costars and then prints all these
+ * Fetches the list of costars and then prints all these
  * costars in a format similar to that used by listMovies.
- * The STL set is used to collect actor/actress names without
- * storing duplicates.
+ * The costars come back from the imdb as actor indexes, along with
+ * the number of films shared with each, in the order of the data
+ * files (which is alphabetical), and only the names actually printed
+ * are decoded.  Actors added by a delta come after all of those, so
+ * when there are any, the costars are sorted by name first.
  *
  * @param player the actor/actress of interest.
- * @param credits the list of movies that the specified actor/actress has appeared in.
- *                (No integrity checks are done, so it's the client's responsibility to make sure
- *                 the specified actor/actress really has appeared in these movies.)
- * @param db the imdb housing the specified plater, list of movies, etc.  This is passed in
- *           so that each member of each cast of each movie can be added to the specified player's
- *           set of costars.
+ * @param db the imdb housing the specified player.
  */
 
-static void listCostars(const string &player, const vector<film>& credits, const imdb& db)
+static void listCostars(const string &player, const imdb& db)
 {
   const unsigned int kNumCostarsToPrint = 10;
-  map<string, set<film> > costars;
-  for (int i = 0; i < (int) credits.size(); i++) {
-    const film& movie = credits[i];
-    vector<string> cast;
-    db.getCast(movie, cast);
-    for (int j = 0; j < (int) cast.size(); j++) {
-      const string& costar = cast[j];
-      if (costar != player) costars[costar].insert(movie);
-    }
+  vector<imdb::costar> costars;
+  db.getCostars(player, costars);
+  if (db.getNumDeltaActors() > 0) {
+    sort(costars.begin(), costars.end(), [&db](const imdb::costar& a, const imdb::costar& b) {
+      return db.getActorName(a.actor) < db.getActorName(b.actor);
+    });
   }
   
   cout << player << " has worked with " << (int) costars.size() << " other people." << endl;
   cout << "Those other people are:" << endl;
   
   unsigned int numCostars = 0;
-  map<string, set<film> >::const_iterator curr;
+  vector<imdb::costar>::const_iterator curr;
   for (curr = costars.begin(); curr != costars.end() && numCostars < kNumCostarsToPrint; ++curr) {
-    const string& costar = curr->first;
-    cout << setw(5) << ++numCostars << ".) " << costar;
-    if (curr->second.size() > 1) cout << " (in " << (int) curr->second.size() << " different films)";
+    cout << setw(5) << ++numCostars << ".) " << db.getActorName(curr->actor);
+    if (curr->numShared > 1) cout << " (in " << curr->numShared << " different films)";
     cout << endl;
   }
 
@@ -117,9 +111,8 @@ static void listCostars(const string &player, const vector<film>& credits, const
     if (costars.size() > 2 * kNumCostarsToPrint) printFill();
     while (numCostars < costars.size() - kNumCostarsToPrint) { numCostars++; ++curr; }
     for (; curr != costars.end(); ++curr) {
-      const string& costar = curr->first;
-      cout << setw(5) << ++numCostars << ".) " << costar;
-      if (curr->second.size() > 1) cout << " (in " << (int) curr->second.size() << " different films)";
+      cout << setw(5) << ++numCostars << ".) " << db.getActorName(curr->actor);
+      if (curr->numShared > 1) cout << " (in " << curr->numShared << " different films)";
       cout << endl;
     }
   }
@@ -160,7 +153,7 @@ static void listAllMoviesAndCostars(const string& player,
   }
   
   listMovies(player, credits);
-  listCostars(player, credits, db);
+  listCostars(player, db);
 }
 
 /**
@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <string.h>
+#include <unistd.h>
 #include <iostream>
 using namespace std;
 
@@ -48,27 +49,26 @@ struct film {
 };
 
 /**
- * Quick, UNIX-dependent function to determine whether or not the
- * the resident OS is Linux or Solaris.  For our purposes, this
- * tells us whether the machine is big-endian or little-endian, and
- * the endiannees tells us which set of raw binary data files we should
- * be using.
+ * Determines which directory of data files to use when the user doesn't
+ * name one.  A directory of converted data (see imdb-convert), which is
+ * native-endian by construction, is preferred whenever one's been built;
+ * otherwise the choice between the two original data sets is made from
+ * the byte order this program was compiled for (rather than from the
+ * OSTYPE environment variable, which isn't always set).
  *
- * @return one of two data paths.
+ * @return one of the data paths.
  */
 
 inline const char *determinePathToData(const char *userSelectedPath = NULL)
 {
   if (userSelectedPath != NULL) return userSelectedPath;
-  const char *ostype = getenv("OSTYPE");
-  // if (strcasecmp(ostype, "linux") == 0)
+  const char *nativePath = "/home/manavagrwl/stan_cs107/assign2/assn-2-six-degrees-data/native/";
+  if (access((string(nativePath) + "imdbdata").c_str(), R_OK) == 0) return nativePath;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  return "/home/manavagrwl/stan_cs107/assign2/assn-2-six-degrees-data/big-endian/";
+#else
   return "/home/manavagrwl/stan_cs107/assign2/assn-2-six-degrees-data/little-endian/";
-  if (strcasecmp(ostype, "solaris") == 0)
-    return "/home/manavagrwl/stan_cs107/assign2/assn-2-six-degrees-data/big-endian/";
-  
-  // cerr << "Unsupported OS... bailing" << endl;
-  // exit(1);
-  // return NULL;
+#endif
 }
 
 #endif
@@ -2,144 +2,830 @@ using namespace std;
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
+#include <sys/file.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
 #include "imdb.h"
+#include "mapped-file.h"
+#include "search-stats.h"
 
 const char *const imdb::kActorFileName = "actordata";
 const char *const imdb::kMovieFileName = "moviedata";
-typedef struct {
-  const string *key;
-  void *base;
-} keyStruct;
-typedef struct {
-  const film *f;
-  void *base;
-} filmStruct;
+const char *const imdb::kActorIndexFileName = "actorindex";
+const char *const imdb::kMovieIndexFileName = "movieindex";
+const char *const imdb::kDataFileName = "imdbdata";
+const char *const imdb::kDeltaFileName = "imdbdelta";
+static const int kIndexMagic = 0x58444d49; // "IMDX" on little-endian machines
+
+/**
+ * Every record of an original data file is a multiple of 4 bytes long and lies
+ * after the offset table, so every offset in the table is word-aligned and
+ * falls between the end of the table and the end of the file.  That holds
+ * whatever order the records are laid out in, and only in the byte order the
+ * file was written in; a sample of the offsets is checked, spread evenly
+ * across the table, rather than all of them.
+ */
+
+static const int kNumSampledOffsets = 64;
+
+static bool inHostOrder(const void *file, size_t fileSize)
+{
+  if (file == NULL || fileSize < sizeof(int)) return false;
+  const int *table = (const int *) file;
+  long long count = table[0];
+  if (count < 0 || (count + 1) * sizeof(int) > fileSize) return false;
+  long long step = max(count / kNumSampledOffsets, 1LL);
+  for (long long i = 0; i < count; i += step) {
+    int offset = table[1 + (i + step >= count ? count - 1 : i)];
+    if (offset % sizeof(int) != 0 || offset < (count + 1) * (long long) sizeof(int) ||
+        (size_t) offset >= fileSize) return false;
+  }
+  return true;
+}
 
 imdb::imdb(const string& directory)
 {
   const string actorFileName = directory + "/" + kActorFileName;
   const string movieFileName = directory + "/" + kMovieFileName;
-  
-  actorFile = acquireFileMap(actorFileName, actorInfo);
-  movieFile = acquireFileMap(movieFileName, movieInfo);
+
+  // a converted data file, if there is one, stands in for both of the original files
+  actorInfo = movieInfo = fileInfo{-1, 0, NULL};
+  if (!acquireData(directory + "/" + kDataFileName)) {
+    actorFile = acquireFileMap(actorFileName, actorInfo);
+    movieFile = acquireFileMap(movieFileName, movieInfo);
+    actorSize = actorInfo.fileSize;
+    movieSize = movieInfo.fileSize;
+    // original data in the other byte order can't be read in place; it needs converting first
+    if (!inHostOrder(actorFile, actorSize) || !inHostOrder(movieFile, movieSize)) actorFile = movieFile = NULL;
+  }
+
+  // the indexes are optional, so they're only used if they're present and match the data
+  acquireFileMap(directory + "/" + kActorIndexFileName, actorIndexInfo);
+  acquireFileMap(directory + "/" + kMovieIndexFileName, movieIndexInfo);
+  actorIndex = good() ? acquireIndex(actorIndexInfo, actorFile, actorSize) : NULL;
+  movieIndex = good() ? acquireIndex(movieIndexInfo, movieFile, movieSize) : NULL;
+
+  actorTree.size = movieTree.size = 0;
+  actorTree.entries = movieTree.entries = NULL;
+  actorTree.indexes = movieTree.indexes = NULL;
+  if (good() && actorIndex == NULL) actorTree.build(actorFile, 1);
+  if (good() && movieIndex == NULL) movieTree.build(movieFile, 2);
+
+  deltaInfo = fileInfo{-1, 0, NULL};
+  deltaSize = 0;
+  if (good()) acquireDelta(directory + "/" + kDeltaFileName);
 }
 
 bool imdb::good() const
 {
-  return !( (actorInfo.fd == -1) || 
-	    (movieInfo.fd == -1) ); 
+  return !( (actorFile == NULL) || 
+	    (movieFile == NULL) ); 
+}
+
+/**
+ * Both record layouts put a '\0'-terminated name first (movies follow it with a
+ * one-byte year), pad that out to an even length, store a short count, and
+ * then pad again so the array of int offsets starts on a multiple of 4.
+ * Returns the count and the address of the first offset in the array.  We
+ * can't just skip '\0' bytes to find them, because the count or the first
+ * offset may well start with one.
+ *
+ * Converted records are simpler: the name is padded straight out to a
+ * multiple of 4, and is followed by an int count and then the offsets.
+ */
+
+static const int *recordOffsets(const char *record, int nameBytes, int& count)
+{
+  if (nameBytes % 2 != 0) nameBytes++;
+  count = *(const short *) (record + nameBytes);
+  int offsetsStart = nameBytes + sizeof(short);
+  if (offsetsStart % 4 != 0) offsetsStart += 2;
+  return (const int *) (record + offsetsStart);
+}
+
+static const int *alignedRecordOffsets(const char *record, int nameBytes, int& count)
+{
+  const int *counted = (const int *) (record + ((nameBytes + 3) & ~3));
+  count = counted[0];
+  return counted + 1;
+}
+
+imdb::actorRecord imdb::getActor(int offset) const
+{
+  const char *record = (const char *) actorFile + offset;
+  actorRecord actor;
+  actor.offset = offset;
+  actor.name = record;
+  actor.credits = converted() ? alignedRecordOffsets(record, actor.name.size() + 1, actor.numCredits) :
+                                recordOffsets(record, actor.name.size() + 1, actor.numCredits);
+  return actor;
+}
+
+imdb::movieRecord imdb::getMovie(int offset) const
+{
+  const char *record = (const char *) movieFile + offset;
+  movieRecord movie;
+  movie.offset = offset;
+  movie.title = record;
+  movie.yearByte = record[movie.title.size() + 1];
+  movie.cast = converted() ? alignedRecordOffsets(record, movie.title.size() + 2, movie.numActors) :
+                             recordOffsets(record, movie.title.size() + 2, movie.numActors);
+  return movie;
+}
+
+/**
+ * Packs the first 12 bytes of a key into a prefix whose integer order matches
+ * strcmp order, zero-filling keys shorter than that.  A key is a name and its
+ * '\0' (and, for a movie, the year byte), so a key of at most 12 bytes sits
+ * entirely inside its prefix, and two equal such prefixes mean equal keys.
+ */
+
+template <typename Entry>
+static void packPrefix(const char *key, int keyLength, Entry& entry)
+{
+  unsigned char bytes[12] = { 0 };
+  memcpy(bytes, key, min(keyLength, 12));
+  entry.high = entry.low = 0;
+  for (int i = 0; i < 8; i++) entry.high = (entry.high << 8) | bytes[i];
+  for (int i = 8; i < 12; i++) entry.low = (entry.low << 8) | bytes[i];
+}
+
+template <typename Entry>
+static bool prefixLess(const Entry& a, const Entry& b)
+{
+  return a.high < b.high || (a.high == b.high && a.low < b.low);
+}
+
+/**
+ * Builds the tree over the offset table at the front of the specified file.
+ * keyExtra is the number of bytes following the name that belong to the key:
+ * 1 for actors (just the '\0'), 2 for movies (the '\0' and the year byte).
+ * Entries are 16 bytes and the array is 64-byte aligned, so the four
+ * grandchildren of any node share a single cache line.
+ */
+
+void imdb::searchTree::build(const void *file, int keyExtra)
+{
+  const int *table = (const int *) file;
+  size = table[0];
+  void *memory;
+  if (posix_memalign(&memory, 64, (size + 1) * sizeof(prefixEntry)) != 0) return;
+  entries = (prefixEntry *) memory;
+  indexes = new int[size + 1];
+  for (int i = 0; i < size; i++) {
+    // stash the prefix of the i'th record in slot i + 1, then permute below.
+    const char *record = (const char *) file + table[i + 1];
+    packPrefix(record, strlen(record) + keyExtra, entries[i + 1]);
+    entries[i + 1].offset = table[i + 1];
+  }
+  vector<prefixEntry> sorted(entries + 1, entries + size + 1);
+  fill(sorted.data(), 0, 1);
+}
+
+// in-order walk of the implicit tree, handing out sorted entries as it goes.
+int imdb::searchTree::fill(const prefixEntry *sorted, int next, int k)
+{
+  if (k > size) return next;
+  next = fill(sorted, next, 2 * k);
+  entries[k] = sorted[next];
+  indexes[k] = next++;
+  return fill(sorted, next, 2 * k + 1);
+}
+
+void imdb::searchTree::release()
+{
+  free(entries);
+  delete[] indexes;
+}
+
+/**
+ * Lookup statistics (see searchStats): countProbe counts one probe of a table
+ * that reads the specified number of its bytes, and countComparison one string
+ * comparison against a record, which reads at most as many of the record's
+ * bytes as the key has, plus a terminator.  Both do nothing if stats is NULL.
+ */
+
+static void countProbe(searchStats *stats, size_t tableBytes)
+{
+  if (stats == NULL) return;
+  stats->probes++;
+  stats->bytesTouched += tableBytes;
+}
+
+static void countComparison(searchStats *stats, size_t keyLength)
+{
+  if (stats == NULL) return;
+  stats->comparisons++;
+  stats->bytesTouched += keyLength + 1;
 }
 
-// you should be implementing these two methods right here...
+/**
+ * Eytzinger lower bound: descends from the root, moving right past every entry
+ * less than the key, and then backs out of the trailing right turns to land on
+ * the first entry not less than the key.  Entries whose prefixes tie the key's
+ * are settled by the tie breaker, which compares the full key against the record
+ * at the specified offset, but only when the key is too long to fit in its prefix.
+ *
+ * @return the index of the matching record, or -1 if there isn't one.
+ */
+
+template <typename TieBreak>
+int imdb::searchTree::find(const prefixEntry& key, int keyLength, TieBreak compare, searchStats *stats) const
+{
+  int k = 1;
+  while (k <= size) {
+    countProbe(stats, 0);
+    __builtin_prefetch(entries + 8 * k);
+    __builtin_prefetch(entries + 8 * k + 4);
+    const prefixEntry& entry = entries[k];
+    bool less = prefixLess(entry, key) ||
+      (!prefixLess(key, entry) && keyLength > 12 && compare(entry.offset) > 0);
+    k = 2 * k + less;
+  }
+  k >>= __builtin_ffs(~k);
+  if (k == 0 || prefixLess(key, entries[k])) return -1;
+  if (keyLength > 12 && compare(entries[k].offset) != 0) return -1;
+  return indexes[k];
+}
+
+// keys live on the caller's stack, so a lookup never allocates.
+typedef struct {
+  string_view key;
+  const char *base;
+  searchStats *stats;
+} keyStruct;
+typedef struct {
+  string_view title;
+  int year;
+  const char *base;
+  searchStats *stats;
+} filmStruct;
+
 static int bsearchCompare (const void* a, const void* b) {
-  keyStruct *param = (keyStruct *) a;
-  int offset = *(int *) b;
+  const keyStruct *param = (const keyStruct *) a;
+  int offset = *(const int *) b;
+  countProbe(param->stats, sizeof(int));
+  countComparison(param->stats, param->key.size());
+  return param->key.compare(param->base + offset);
+}
+
+/**
+ * The indexes hash names with 32-bit FNV-1a, and movies fold
+ * the year byte in after the title.  Since the hashes are
+ * persisted, these can never change without changing kIndexMagic.
+ */
+
+static unsigned int hashName(string_view name)
+{
+  unsigned int hash = 2166136261u;
+  for (char ch: name) {
+    hash ^= (unsigned char) ch;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+static unsigned int hashFilm(string_view title, int year)
+{
+  return (hashName(title) ^ (unsigned char) (year - 1900)) * 16777619u;
+}
+
+int imdb::findActor(string_view player, searchStats *stats) const
+{
+  if (stats != NULL) stats->lookups++;
+  int index = findDataActor(player, stats);
+  if (index != -1 || deltaActorIndexes.empty()) return index;
+  unordered_map<string_view, int>::const_iterator found = deltaActorIndexes.find(player);
+  return found == deltaActorIndexes.end() ? -1 : found->second;
+}
+
+int imdb::findDataActor(string_view player, searchStats *stats) const
+{
+  if (actorIndex != NULL) {
+    const indexSlot *slots = (const indexSlot *) (actorIndex + 1);
+    unsigned int hash = hashName(player);
+    for (int i = hash & (actorIndex->numSlots - 1); ; i = (i + 1) & (actorIndex->numSlots - 1)) {
+      countProbe(stats, sizeof(indexSlot));
+      if (slots[i].index == -1) return -1;
+      if (slots[i].hash != hash) continue;
+      countComparison(stats, player.size());
+      if (player == (const char *) actorFile + getActorOffset(slots[i].index)) return slots[i].index;
+    }
+  }
+
+  if (actorTree.entries != NULL) {
+    char key[12];
+    int keyLength = player.size() + 1;
+    memcpy(key, player.data(), min(keyLength - 1, 12));
+    if (keyLength <= 12) key[keyLength - 1] = '\0';
+    prefixEntry prefix;
+    packPrefix(key, keyLength, prefix);
+    return actorTree.find(prefix, keyLength, [this, player, stats](int offset) {
+      countComparison(stats, player.size());
+      return player.compare((const char *) actorFile + offset);
+    }, stats);
+  }
+
+  const int *start = (const int *) actorFile;
+  keyStruct param = { player, (const char *) actorFile, stats };
+  const int *actorOffset = (const int *) bsearch(&param, start + 1, *start, sizeof(int), bsearchCompare);
+  return actorOffset == NULL ? -1 : actorOffset - (start + 1);
+}
 
-  const char *A = *(const char **) param->key;
-  const char *B = ((char *) param->base + offset);
-  // printf("%s, %s\n", A, B);
-  return strcmp(A, B);
+// films are ordered by title first and year second, same as film::operator<
+static int bsearchFilmCompare (const void *a, const void *b) {
+  const filmStruct *param = (const filmStruct *) a;
+  const char *titleStart = param->base + *(const int *) b;
+  countProbe(param->stats, sizeof(int));
+  countComparison(param->stats, param->title.size() + 1);
+  int cmp = param->title.compare(titleStart);
+  if (cmp != 0) return cmp;
+  return param->year - (1900 + *(titleStart + strlen(titleStart) + 1));
+}
+
+int imdb::findMovie(string_view title, int year, searchStats *stats) const
+{
+  if (stats != NULL) stats->lookups++;
+  // records store the year as a single byte, so no record matches a year outside its range
+  if ((char) (year - 1900) != year - 1900) return -1;
+  int index = findDataMovie(title, year, stats);
+  if (index != -1 || deltaMovieIndexes.empty()) return index;
+  map<pair<string_view, char>, int>::const_iterator found = deltaMovieIndexes.find(make_pair(title, (char) (year - 1900)));
+  return found == deltaMovieIndexes.end() ? -1 : found->second;
 }
+
+int imdb::findDataMovie(string_view title, int year, searchStats *stats) const
+{
+  if (movieIndex != NULL) {
+    const indexSlot *slots = (const indexSlot *) (movieIndex + 1);
+    unsigned int hash = hashFilm(title, year);
+    for (int i = hash & (movieIndex->numSlots - 1); ; i = (i + 1) & (movieIndex->numSlots - 1)) {
+      countProbe(stats, sizeof(indexSlot));
+      if (slots[i].index == -1) return -1;
+      if (slots[i].hash != hash) continue;
+      countComparison(stats, title.size() + 1);
+      movieRecord movie = getMovie(getMovieOffset(slots[i].index));
+      if (movie.title == title && movie.getYear() == year) return slots[i].index;
+    }
+  }
+
+  if (movieTree.entries != NULL) {
+    char key[12];
+    int keyLength = title.size() + 2;
+    memcpy(key, title.data(), min(keyLength - 2, 12));
+    if (keyLength - 2 < 12) key[keyLength - 2] = '\0';
+    if (keyLength - 1 < 12) key[keyLength - 1] = year - 1900;
+    prefixEntry prefix;
+    packPrefix(key, keyLength, prefix);
+    return movieTree.find(prefix, keyLength, [this, title, year, stats](int offset) {
+      countComparison(stats, title.size() + 1);
+      movieRecord movie = getMovie(offset);
+      int cmp = title.compare(movie.title);
+      return cmp != 0 ? cmp : year - movie.getYear();
+    }, stats);
+  }
+
+  const int *start = (const int *) movieFile;
+  filmStruct param = { title, year, (const char *) movieFile, stats };
+  const int *movieOffset = (const int *) bsearch(&param, start + 1, *start, sizeof(int), bsearchFilmCompare);
+  return movieOffset == NULL ? -1 : movieOffset - (start + 1);
+}
+
 bool imdb::getCredits(const string& player, vector<film>& films, short *numCredits, bool onlyNum) const {
-  int *start = (int *) actorInfo.fileMap;
-  char *movieStart = (char *) movieInfo.fileMap;
-  keyStruct *param = new keyStruct;
-  param->key = &player;
-  param->base = start;
-
-  int *actorOffset = (int *) bsearch (param, (void *) (start+1), *start, sizeof(int), bsearchCompare);
-  if (actorOffset == NULL) {
+  int index = findActor(player);
+  if (index == -1) {
     return false;
   }
-  
-  char *actorStart = (char *)start + *actorOffset;
-  string foundActorName(actorStart);
-  assert(player == foundActorName);
 
-  char *loc = (char *) (actorStart + strlen(actorStart));
-  // skip padding
-  while (*loc == '\0') {
-    loc++;
-  }
-  short nFilms = *(short *)loc;
+  // the delta's credits for the actor follow any in the data files
+  actorRecord actor = { -1, player, 0, NULL };
+  if (index < getNumActors()) actor = getActor(getActorOffset(index));
+  vector<pair<int, int> >::const_iterator first =
+    lower_bound(deltaCredits.begin(), deltaCredits.end(), make_pair(index, 0));
+  vector<pair<int, int> >::const_iterator last = first;
+  while (last != deltaCredits.end() && last->first == index) last++;
   if (numCredits != nullptr) {
-    *numCredits = nFilms;
+    *numCredits = actor.numCredits + (last - first);
     if (onlyNum) {
       return true;
     }
   }
-  loc += sizeof(short);
-  // skip padding
-  while (*loc == '\0') {
-    loc++;
-  }
-
-  for (int i = 0; i < nFilms; i++) {
-    film f;
-    int *movieOffset = ((int *)loc + i);
-    char *movieNameStart = movieStart + *movieOffset;
-    f.title = movieNameStart; // it will automatically call constructor and take until \0 only
-    char *yearOffset = movieNameStart + strlen(movieNameStart) + 1;
-    f.year = 1900 + *yearOffset;
-    films.push_back(f);
+  for (int i = 0; i < actor.numCredits; i++) {
+    films.push_back(getMovie(actor.credits[i]).getFilm());
   }
+  for (; first != last; first++) films.push_back(getFilm(first->second));
   return true; 
 }
 
-static int bsearchFilmCompare (const void *a, const void *b) {
-  film f;
-  filmStruct *A = (filmStruct *) a;
-  int *offset = (int *) b;
-  char *titleStart = (char *) A->base + *offset;
-  f.title = titleStart;
-  f.year = 1900 + *(titleStart + strlen(titleStart) + 1);
-  if (*(A->f) < f) {
-    return -1;
-  }
-  if (*(A->f) == f) {
-    return 0;
-  } 
-  return 1;
-}
 bool imdb::getCast(const film& movie, vector<string>& players) const { 
-  int *start = (int *) movieInfo.fileMap;
-  char *actorStart = (char *) actorInfo.fileMap; 
-  filmStruct *param = new filmStruct;
-  string movieName = movie.title;
-  param->f = &movie;
-  param->base = start;
-  int *movieOffset = (int *) bsearch (param, (void *) (start+1), *start, sizeof(int), bsearchFilmCompare);
-  if (movieOffset == NULL) {
+  int index = findMovie(movie.title, movie.year);
+  if (index == -1) {
     return false;
   }
-  char *movieNameStart = (char *)start + *movieOffset;
-  string foundMovieName(movieNameStart);
-  assert(movieName == foundMovieName);
-  int numActorsOffset = strlen(movieNameStart) + 2; // for \0 and year
-  if (numActorsOffset % 2 != 0) {
-    numActorsOffset++;
+
+  if (index < getNumMovies()) {
+    movieRecord record = getMovie(getMovieOffset(index));
+    for (int i = 0; i < record.numActors; i++) {
+      players.push_back(string(getActor(record.cast[i]).name));
+    }
   }
-  int numActors = *(short *) ((char *) start + *movieOffset + numActorsOffset);
-  int actorsOffset = 2;
-  if ((numActorsOffset + 2) % 4 != 0) {
-    actorsOffset = 4;
+  vector<pair<int, int> >::const_iterator first =
+    lower_bound(deltaCasts.begin(), deltaCasts.end(), make_pair(index, 0));
+  for (; first != deltaCasts.end() && first->first == index; first++)
+    players.push_back(string(getActorName(first->second)));
+  return true;
+}
+
+bool imdb::getCostars(string_view player, vector<costar>& costars) const
+{
+  costars.clear();
+  int index = findActor(player);
+  if (index == -1) return false;
+
+  // the player's movies in the data files, by record offset, whichever side credits them
+  vector<int> creditOffsets;
+  if (index < getNumActors()) {
+    actorRecord actor = getActor(getActorOffset(index));
+    creditOffsets.assign(actor.credits, actor.credits + actor.numCredits);
+  }
+  vector<pair<int, int> >::const_iterator first =
+    lower_bound(deltaCredits.begin(), deltaCredits.end(), make_pair(index, 0));
+  vector<pair<int, int> >::const_iterator last = first;
+  for (; last != deltaCredits.end() && last->first == index; last++)
+    if (last->second < getNumMovies()) creditOffsets.push_back(getMovieOffset(last->second));
+  sort(creditOffsets.begin(), creditOffsets.end());
+
+  vector<int> offsets;
+  for (int offset: creditOffsets) {
+    movieRecord movie = getMovie(offset);
+    offsets.insert(offsets.end(), movie.cast, movie.cast + movie.numActors);
+  }
+  sort(offsets.begin(), offsets.end());
+  for (size_t i = 0, j; i < offsets.size(); i = j) {
+    for (j = i + 1; j < offsets.size() && offsets[j] == offsets[i]; j++);
+    costars.push_back(costar{getActorIndex(offsets[i]), (int) (j - i)});
+  }
+
+  // the delta's additions to the casts of any of the player's movies
+  vector<int> ids;
+  for (const pair<int, int>& cast: deltaCasts) {
+    bool shared = cast.first < getNumMovies() ?
+      binary_search(creditOffsets.begin(), creditOffsets.end(), getMovieOffset(cast.first)) :
+      binary_search(first, last, make_pair(index, cast.first));
+    if (shared) ids.push_back(cast.second);
   }
-  int *loc = (int *) ((char *) movieFile + *movieOffset + numActorsOffset + actorsOffset);
-  for (int i = 0; i < numActors; i++) {
-    int actorOffset = *(loc + i);
-    string actorName = actorStart + actorOffset;
-    players.push_back(actorName);
+  sort(ids.begin(), ids.end());
+  for (size_t i = 0, j; i < ids.size(); i = j) {
+    for (j = i + 1; j < ids.size() && ids[j] == ids[i]; j++);
+    costars.push_back(costar{ids[i], (int) (j - i)});
   }
+
+  sort(costars.begin(), costars.end(), [](const costar& a, const costar& b) { return a.actor < b.actor; });
+  size_t kept = 0;
+  for (size_t i = 0; i < costars.size(); i++) {
+    if (costars[i].actor == index) continue;
+    if (kept > 0 && costars[kept - 1].actor == costars[i].actor) costars[kept - 1].numShared += costars[i].numShared;
+    else costars[kept++] = costars[i];
+  }
+  costars.resize(kept);
   return true;
 }
 
+/**
+ * Turns an actor's record offset back into its index.  The records are laid
+ * out in sorted order in every data set we know of, so the offset table is
+ * increasing and a binary search finds the offset, but if it isn't, we fall
+ * back on looking the name up.
+ */
+
+int imdb::getActorIndex(int offset) const
+{
+  const int *table = (const int *) actorFile;
+  call_once(actorOrderChecked, [this, table]() {
+    actorOffsetsAscending = true;
+    for (int i = 2; i <= getNumActors() && actorOffsetsAscending; i++) actorOffsetsAscending = table[i - 1] < table[i];
+  });
+  if (!actorOffsetsAscending) return findDataActor(getActor(offset).name, NULL);
+  return lower_bound(table + 1, table + getNumActors() + 1, offset) - (table + 1);
+}
+
+string_view imdb::getActorName(int index) const
+{
+  return index < getNumActors() ? getActor(getActorOffset(index)).name : deltaActors[index - getNumActors()];
+}
+
+film imdb::getFilm(int index) const
+{
+  if (index < getNumMovies()) return getMovie(getMovieOffset(index)).getFilm();
+  film f;
+  f.title = deltaMovies[index - getNumMovies()].first;
+  f.year = 1900 + deltaMovies[index - getNumMovies()].second;
+  return f;
+}
+
+/**
+ * Writes a single index file: a header followed by an open-addressed table,
+ * sized to the smallest power of two that keeps it at most half full, so
+ * the linear probe for a name usually ends at its first slot.  The table is
+ * written to a temporary file and renamed into place, so an imdb opening
+ * the directory concurrently never sees a partial index.
+ */
+
+bool imdb::writeIndex(const string& fileName, const vector<unsigned int>& hashes, int dataSize)
+{
+  indexHeader header;
+  header.magic = kIndexMagic;
+  header.numRecords = hashes.size();
+  header.dataSize = dataSize;
+  header.numSlots = 1;
+  while (header.numSlots < 2 * header.numRecords) header.numSlots *= 2;
+
+  vector<indexSlot> slots(header.numSlots, indexSlot{0, -1});
+  for (int i = 0; i < header.numRecords; i++) {
+    int slot = hashes[i] & (header.numSlots - 1);
+    while (slots[slot].index != -1) slot = (slot + 1) & (header.numSlots - 1);
+    slots[slot] = indexSlot{hashes[i], i};
+  }
+
+  vector<char> index(sizeof(header) + slots.size() * sizeof(indexSlot));
+  memcpy(index.data(), &header, sizeof(header));
+  memcpy(index.data() + sizeof(header), slots.data(), slots.size() * sizeof(indexSlot));
+  return mappedFile::writeAtomically(fileName, index.data(), index.size());
+}
+
+bool imdb::writeIndexes(const string& directory) const
+{
+  vector<unsigned int> hashes(getNumActors());
+  for (int i = 0; i < getNumActors(); i++)
+    hashes[i] = hashName(getActor(getActorOffset(i)).name);
+  if (!writeIndex(directory + "/" + kActorIndexFileName, hashes, actorSize)) return false;
+
+  hashes.resize(getNumMovies());
+  for (int i = 0; i < getNumMovies(); i++) {
+    movieRecord movie = getMovie(getMovieOffset(i));
+    hashes[i] = hashFilm(movie.title, movie.getYear());
+  }
+  return writeIndex(directory + "/" + kMovieIndexFileName, hashes, movieSize);
+}
+
+/**
+ * Decodes the delta entry at the start of the specified bytes, checking that
+ * its length is sane and that everything it claims to hold lies within it.
+ *
+ * @return the entry's length in bytes, or 0 if the entry is damaged or doesn't
+ *         fit in the bytes available.
+ */
+
+static size_t parseDeltaEntry(const char *entry, size_t available, string_view& title, char& yearByte,
+                              vector<string_view>& names)
+{
+  if (available < sizeof(int)) return 0;
+  int length = *(const int *) entry;
+  if (length < 3 * (int) sizeof(int) || length % 4 != 0 || (size_t) length > available) return 0;
+  const char *end = entry + length;
+  const char *titleStart = entry + sizeof(int);
+  const char *titleEnd = (const char *) memchr(titleStart, '\0', end - titleStart);
+  if (titleEnd == NULL || titleEnd == titleStart || titleEnd + 1 == end) return 0;
+  title = string_view(titleStart, titleEnd - titleStart);
+  yearByte = titleEnd[1];
+
+  size_t countAt = (titleEnd + 2 - entry + 3) & ~3;
+  if (countAt + sizeof(int) > (size_t) length) return 0;
+  int count = *(const int *) (entry + countAt);
+  if (count < 0) return 0;
+  names.clear();
+  const char *name = entry + countAt + sizeof(int);
+  for (int i = 0; i < count; i++) {
+    const char *nameEnd = (const char *) memchr(name, '\0', end - name);
+    if (nameEnd == NULL || nameEnd == name) return 0;
+    names.push_back(string_view(name, nameEnd - name));
+    name = nameEnd + 1;
+  }
+  return (size_t) ((name - entry + 3) & ~3) == (size_t) length ? length : 0;
+}
+
+/**
+ * The entries are encoded in full before the delta is touched, and then written
+ * with one write on a descriptor opened for appending, under an exclusive lock
+ * so that appenders never interleave.  A new delta gets its header in the same
+ * write.  If an earlier append was cut short, the damaged tail is cut off first,
+ * so that the new entries aren't stranded behind it.
+ */
+
+bool imdb::appendToDelta(const string& directory, const vector<deltaEntry>& entries) const
+{
+  vector<char> bytes;
+  auto pad = [&bytes](size_t start) { while ((bytes.size() - start) % 4 != 0) bytes.push_back('\0'); };
+  auto append = [&bytes](const void *data, size_t length) {
+    bytes.insert(bytes.end(), (const char *) data, (const char *) data + length);
+  };
+  for (const deltaEntry& entry: entries) {
+    const string& title = entry.movie.title;
+    if (title.empty() || title.find('\0') != string::npos ||
+        (char) (entry.movie.year - 1900) != entry.movie.year - 1900) return false;
+    size_t start = bytes.size();
+    int length = 0, count = entry.cast.size();
+    char yearByte = entry.movie.year - 1900;
+    append(&length, sizeof(int));
+    append(title.c_str(), title.size() + 1);
+    append(&yearByte, 1);
+    pad(start);
+    append(&count, sizeof(int));
+    for (const string& name: entry.cast) {
+      if (name.empty() || name.find('\0') != string::npos) return false;
+      append(name.c_str(), name.size() + 1);
+    }
+    pad(start);
+    length = bytes.size() - start;
+    memcpy(bytes.data() + start, &length, sizeof(int));
+  }
+
+  const string fileName = directory + "/" + kDeltaFileName;
+  int fd = open(fileName.c_str(), O_RDWR | O_APPEND | O_CREAT, 0644);
+  if (fd == -1) return false;
+  bool appended = false;
+  struct stat stats;
+  if (flock(fd, LOCK_EX) == 0 && fstat(fd, &stats) == 0) {
+    const deltaHeader expected = { kDeltaMagic, kDeltaVersion, kByteOrderMark, getNumActors(), getNumMovies(), 0 };
+    size_t end = stats.st_size;
+    bool usable = true;
+    if (end == 0) {
+      bytes.insert(bytes.begin(), (const char *) &expected, (const char *) (&expected + 1));
+    } else {
+      vector<char> existing(end);
+      usable = pread(fd, existing.data(), end, 0) == (ssize_t) end && end >= sizeof(deltaHeader) &&
+               memcmp(existing.data(), &expected, sizeof(deltaHeader)) == 0;
+      size_t position = sizeof(deltaHeader), length;
+      string_view title;
+      char yearByte;
+      vector<string_view> names;
+      while (usable && (length = parseDeltaEntry(existing.data() + position, end - position, title, yearByte, names)) != 0)
+        position += length;
+      if (usable && position < end) usable = ftruncate(fd, position) == 0;
+    }
+    if (usable)
+      appended = write(fd, bytes.data(), bytes.size()) == (ssize_t) bytes.size();
+  }
+  close(fd);
+  return appended;
+}
+
+/**
+ * Every map backing the imdb, in a fixed order: the original data files or the
+ * converted one (whichever is in use), the delta, and then the indexes, if
+ * they're in use.
+ */
+
+vector<const imdb::fileInfo *> imdb::getMaps() const
+{
+  vector<const fileInfo *> maps;
+  for (const fileInfo *info: { &actorInfo, &movieInfo, &dataInfo, &deltaInfo })
+    if (info->fileMap != NULL) maps.push_back(info);
+  if (actorIndex != NULL) maps.push_back(&actorIndexInfo);
+  if (movieIndex != NULL) maps.push_back(&movieIndexInfo);
+  return maps;
+}
+
+/**
+ * Pages in the specified range synchronously: MADV_POPULATE_READ does it in one
+ * call on kernels that support it, and otherwise we read one byte of every page.
+ */
+
+static void pageIn(const char *start, size_t length)
+{
+  const size_t pageSize = sysconf(_SC_PAGESIZE);
+  const char *first = start - (uintptr_t) start % pageSize;
+  length += start - first;
+#ifdef MADV_POPULATE_READ
+  if (madvise((void *) first, length, MADV_POPULATE_READ) == 0) return;
+#endif
+  volatile char sink = 0;
+  for (size_t page = 0; page < length; page += pageSize) sink += first[page];
+  (void) sink;
+}
+
+void imdb::populate() const
+{
+  for (const fileInfo *info: getMaps()) {
+    madvise((void *) info->fileMap, info->fileSize, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+    madvise((void *) info->fileMap, info->fileSize, MADV_HUGEPAGE);
+#endif
+    pageIn((const char *) info->fileMap, info->fileSize);
+    madvise((void *) info->fileMap, info->fileSize, MADV_NORMAL);
+  }
+}
+
+/**
+ * A profile is a profileHeader, then a (file size, page count) pair for every
+ * map, and then a bitmap of the resident pages of every map in turn, each
+ * rounded up to a whole number of bytes.  A profile only applies to maps of
+ * exactly the sizes it was recorded against.
+ */
+
+static const int kProfileMagic = 0x464c5250; // "PRLF" on little-endian machines
+
+struct profileHeader {
+  int magic;
+  int numMaps;
+  long long pageSize;
+};
+
+bool imdb::recordProfile(const string& profileName) const
+{
+  vector<const fileInfo *> maps = getMaps();
+  const size_t pageSize = sysconf(_SC_PAGESIZE);
+  profileHeader header = { kProfileMagic, (int) maps.size(), (long long) pageSize };
+  vector<long long> sizes;
+  vector<unsigned char> bitmaps;
+  for (const fileInfo *info: maps) {
+    size_t numPages = (info->fileSize + pageSize - 1) / pageSize;
+    vector<unsigned char> resident(numPages);
+    if (mincore((void *) info->fileMap, info->fileSize, resident.data()) != 0) return false;
+    sizes.push_back(info->fileSize);
+    sizes.push_back(numPages);
+    size_t base = bitmaps.size();
+    bitmaps.resize(base + (numPages + 7) / 8, 0);
+    for (size_t page = 0; page < numPages; page++)
+      if (resident[page] & 1) bitmaps[base + page / 8] |= 1 << (page % 8);
+  }
+
+  vector<char> profile(sizeof(header) + sizes.size() * sizeof(long long) + bitmaps.size());
+  char *p = profile.data();
+  memcpy(p, &header, sizeof(header));
+  memcpy(p + sizeof(header), sizes.data(), sizes.size() * sizeof(long long));
+  memcpy(p + sizeof(header) + sizes.size() * sizeof(long long), bitmaps.data(), bitmaps.size());
+  return mappedFile::writeAtomically(profileName, profile.data(), profile.size());
+}
+
+bool imdb::warm(const string& profileName) const
+{
+  pageIn((const char *) actorFile, (getNumActors() + 1) * sizeof(int));
+  pageIn((const char *) movieFile, (getNumMovies() + 1) * sizeof(int));
+  if (profileName.empty()) return true;
+
+  fileInfo profileInfo;
+  const profileHeader *header = (const profileHeader *) acquireFileMap(profileName, profileInfo);
+  vector<const fileInfo *> maps = getMaps();
+  const size_t pageSize = sysconf(_SC_PAGESIZE);
+  bool valid = header != NULL && profileInfo.fileSize >= sizeof(profileHeader) &&
+               header->magic == kProfileMagic && header->numMaps == (int) maps.size() &&
+               header->pageSize == (long long) pageSize &&
+               profileInfo.fileSize >= sizeof(profileHeader) + 2 * maps.size() * sizeof(long long);
+  const long long *sizes = (const long long *) (header + 1);
+  size_t bitmapBytes = 0;
+  for (size_t i = 0; valid && i < maps.size(); i++) {
+    valid = sizes[2 * i] == (long long) maps[i]->fileSize &&
+            sizes[2 * i + 1] == (long long) ((maps[i]->fileSize + pageSize - 1) / pageSize);
+    bitmapBytes += (sizes[2 * i + 1] + 7) / 8;
+  }
+  valid = valid && profileInfo.fileSize == sizeof(profileHeader) + 2 * maps.size() * sizeof(long long) + bitmapBytes;
+
+  // page in each run of resident pages with a single call
+  const unsigned char *bitmap = (const unsigned char *) (sizes + 2 * maps.size());
+  for (size_t i = 0; valid && i < maps.size(); i++) {
+    size_t numPages = sizes[2 * i + 1];
+    const char *start = (const char *) maps[i]->fileMap;
+    for (size_t page = 0; page < numPages; page++) {
+      if (!(bitmap[page / 8] & (1 << (page % 8)))) continue;
+      size_t run = page;
+      while (run < numPages && (bitmap[run / 8] & (1 << (run % 8)))) run++;
+      pageIn(start + page * pageSize, min(run * pageSize, maps[i]->fileSize) - page * pageSize);
+      page = run;
+    }
+    bitmap += (numPages + 7) / 8;
+  }
+  releaseFileMap(profileInfo);
+  return valid;
+}
+
+bool imdb::evict() const
+{
+  bool evicted = true;
+  for (const fileInfo *info: getMaps()) {
+    evicted = madvise((void *) info->fileMap, info->fileSize, MADV_DONTNEED) == 0 && evicted;
+#ifdef POSIX_FADV_DONTNEED
+    evicted = posix_fadvise(info->fd, 0, 0, POSIX_FADV_DONTNEED) == 0 && evicted;
+#endif
+  }
+  return evicted;
+}
+
 imdb::~imdb()
 {
   releaseFileMap(actorInfo);
   releaseFileMap(movieInfo);
+  releaseFileMap(actorIndexInfo);
+  releaseFileMap(movieIndexInfo);
+  releaseFileMap(dataInfo);
+  releaseFileMap(deltaInfo);
+  actorTree.release();
+  movieTree.release();
 }
 
 // ignore everything below... it's all UNIXy stuff in place to make a file look like
@@ -147,10 +833,131 @@ imdb::~imdb()
 const void *imdb::acquireFileMap(const string& fileName, struct fileInfo& info)
 {
   struct stat stats;
-  stat(fileName.c_str(), &stats);
-  info.fileSize = stats.st_size;
+  info.fileMap = NULL;
+  info.fileSize = 0;
   info.fd = open(fileName.c_str(), O_RDONLY);
-  return info.fileMap = mmap(0, info.fileSize, PROT_READ, MAP_SHARED, info.fd, 0);
+  if (info.fd == -1 || fstat(info.fd, &stats) == -1 || stats.st_size == 0) return NULL;
+  info.fileSize = stats.st_size;
+  void *fileMap = mmap(0, info.fileSize, PROT_READ, MAP_SHARED, info.fd, 0);
+  return info.fileMap = (fileMap == MAP_FAILED ? NULL : fileMap);
+}
+
+/**
+ * Maps a converted data file, and points actorFile and movieFile at its two
+ * sections, but only if its header is intact: the right magic number, version
+ * and byte order, and sections that are aligned, lie within the file, and
+ * begin with counts and offset tables matching the header.  Every offset in
+ * the tables must land inside its section, aligned.  Records are then read
+ * straight out of the map, with no swapping.
+ *
+ * @return true if and only if the converted data file is in use.
+ */
+
+static bool validSection(const char *section, long long size, int count)
+{
+  const int *table = (const int *) section;
+  if (size < (count + 1LL) * (long long) sizeof(int) || table[0] != count) return false;
+  for (int i = 1; i <= count; i++)
+    if (table[i] < (count + 1LL) * (long long) sizeof(int) || table[i] >= size || table[i] % 4 != 0) return false;
+  return true;
+}
+
+bool imdb::acquireData(const string& fileName)
+{
+  if (acquireFileMap(fileName, dataInfo) == NULL) return false;
+  const dataHeader *header = (const dataHeader *) dataInfo.fileMap;
+  const char *base = (const char *) dataInfo.fileMap;
+  long long fileSize = dataInfo.fileSize;
+  bool valid = fileSize >= (long long) sizeof(dataHeader) &&
+    header->magic == kDataMagic && header->version == kDataVersion && header->byteOrder == kByteOrderMark &&
+    header->numActors >= 0 && header->numMovies >= 0 &&
+    header->actorSection % kDataAlignment == 0 && header->movieSection % kDataAlignment == 0 &&
+    header->actorSection >= (long long) sizeof(dataHeader) && header->actorSectionSize >= 0 &&
+    header->actorSection + header->actorSectionSize <= header->movieSection && header->movieSectionSize >= 0 &&
+    header->movieSection + header->movieSectionSize == fileSize &&
+    validSection(base + header->actorSection, header->actorSectionSize, header->numActors) &&
+    validSection(base + header->movieSection, header->movieSectionSize, header->numMovies);
+  if (!valid) {
+    releaseFileMap(dataInfo);
+    dataInfo = fileInfo{-1, 0, NULL};
+    return false;
+  }
+
+  actorFile = base + header->actorSection;
+  movieFile = base + header->movieSection;
+  actorSize = header->actorSectionSize;
+  movieSize = header->movieSectionSize;
+  return true;
+}
+
+/**
+ * Maps the delta and decodes it, entry by entry, until the end of the file or
+ * the first damaged entry.  Movies and actors are looked up in the data files
+ * first, and then among those already decoded, and only get indexes of their
+ * own if they're new.  Credits the data files already have are dropped, and so
+ * are repeats.  The delta is released if its header is damaged or it was
+ * written against other data files.
+ */
+
+void imdb::acquireDelta(const string& fileName)
+{
+  const deltaHeader *header = (const deltaHeader *) acquireFileMap(fileName, deltaInfo);
+  if (header == NULL || deltaInfo.fileSize < sizeof(deltaHeader) || header->magic != kDeltaMagic ||
+      header->version != kDeltaVersion || header->byteOrder != kByteOrderMark ||
+      header->numActors != getNumActors() || header->numMovies != getNumMovies()) {
+    releaseFileMap(deltaInfo);
+    deltaInfo = fileInfo{-1, 0, NULL};
+    return;
+  }
+
+  const char *base = (const char *) deltaInfo.fileMap;
+  size_t position = sizeof(deltaHeader), length;
+  string_view title;
+  char yearByte;
+  vector<string_view> names;
+  while ((length = parseDeltaEntry(base + position, deltaInfo.fileSize - position, title, yearByte, names)) != 0) {
+    position += length;
+    int movie = findDataMovie(title, 1900 + yearByte, NULL);
+    if (movie == -1) {
+      pair<map<pair<string_view, char>, int>::iterator, bool> inserted =
+        deltaMovieIndexes.insert(make_pair(make_pair(title, yearByte), getNumMovies() + getNumDeltaMovies()));
+      if (inserted.second) deltaMovies.push_back(make_pair(title, yearByte));
+      movie = inserted.first->second;
+    }
+    for (string_view name: names) {
+      int actor = findDataActor(name, NULL);
+      if (actor == -1) {
+        pair<unordered_map<string_view, int>::iterator, bool> inserted =
+          deltaActorIndexes.insert(make_pair(name, getNumActors() + getNumDeltaActors()));
+        if (inserted.second) deltaActors.push_back(name);
+        actor = inserted.first->second;
+      }
+      if (actor < getNumActors() && movie < getNumMovies()) {
+        movieRecord record = getMovie(getMovieOffset(movie));
+        if (find(record.cast, record.cast + record.numActors, getActorOffset(actor)) != record.cast + record.numActors)
+          continue;
+      }
+      deltaCredits.push_back(make_pair(actor, movie));
+    }
+  }
+  deltaSize = position;
+
+  sort(deltaCredits.begin(), deltaCredits.end());
+  deltaCredits.erase(unique(deltaCredits.begin(), deltaCredits.end()), deltaCredits.end());
+  for (const pair<int, int>& credit: deltaCredits) deltaCasts.push_back(make_pair(credit.second, credit.first));
+  sort(deltaCasts.begin(), deltaCasts.end());
+}
+
+// an index is only trusted if it was built from data files of exactly this shape
+const imdb::indexHeader *imdb::acquireIndex(const struct fileInfo& info, const void *data, size_t dataSize)
+{
+  const indexHeader *header = (const indexHeader *) info.fileMap;
+  if (header == NULL || info.fileSize < sizeof(indexHeader)) return NULL;
+  if (header->magic != kIndexMagic || header->numRecords != *(const int *) data ||
+      header->dataSize != (int) dataSize || header->numSlots <= header->numRecords ||
+      (header->numSlots & (header->numSlots - 1)) != 0 ||
+      info.fileSize != sizeof(indexHeader) + header->numSlots * sizeof(indexSlot)) return NULL;
+  return header;
 }
 
 void imdb::releaseFileMap(struct fileInfo& info)
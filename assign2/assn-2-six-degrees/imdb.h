@@ -2,10 +2,17 @@
 #define __imdb__
 
 #include "imdb-utils.h"
+#include <map>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 using namespace std;
 
+struct searchStats;
+
 class imdb {
   
  public:
@@ -19,6 +26,17 @@ class imdb {
    * all of the information about the movies and actors relevant to an IMDB
    * application (like six-degrees).
    *
+   * If the directory holds a converted data file (see imdb-convert), it's used
+   * in place of actordata and moviedata: it holds the same records, but in the
+   * byte order of the machine that converted it and with every count and offset
+   * aligned.  The file is only used if its header checks out.
+   *
+   * If the directory holds a delta (see appendToDelta) written against data with
+   * the same numbers of actors and movies, its movies and credits are merged
+   * into everything the imdb reports by name or by index.  Anything in the
+   * delta that's damaged, such as the end of an interrupted append, is ignored
+   * along with everything after it.
+   *
    * @param directory the name of the directory housing the formatted information backing the imdb.
    */
 
@@ -78,6 +96,339 @@ class imdb {
 
   bool getCast(const film& movie, vector<string>& players) const;
 
+  /**
+   * Method: getCostars
+   * ------------------
+   * Finds everyone the specified actor/actress has worked with, and in how
+   * many movies, as actor indexes rather than names, so that answering "who
+   * has this actor worked with" takes one call and no strings.  Every cast
+   * member of every credit is gathered by record offset, and the offsets are
+   * sorted and counted in runs, so each co-star is turned into an index just
+   * once, however many movies they share.
+   *
+   * @param player the name of the actor or actress being queried.
+   * @param costars cleared, and then populated with every co-star (never the
+   *                player), in increasing order of index, which is
+   *                alphabetical except that actors added by the delta
+   *                come after everyone in the data files.  Pass the
+   *                indexes to getActorName to decode them.
+   * @return true if and only if the specified actor/actress appeared in the
+   *              database, and false otherwise.
+   */
+
+  struct costar {
+    int actor;
+    int numShared;
+  };
+
+  bool getCostars(string_view player, vector<costar>& costars) const;
+
+  /**
+   * Convenience structs: actorRecord
+   *                      movieRecord
+   * --------------------------------
+   * Lightweight views of a single actor or movie record, pointing straight
+   * into the memory-mapped data files.  Nothing is copied, so a record is
+   * only valid for as long as the imdb that produced it.  The credits of an
+   * actor are the moviedata offsets of the movies the actor appeared in,
+   * and the cast of a movie is the list of actordata offsets of its actors;
+   * either can be passed right back to getMovie or getActor.
+   */
+
+  struct actorRecord {
+    int offset;
+    string_view name;
+    int numCredits;
+    const int *credits;
+
+    size_t getSize() const { return (const char *) (credits + numCredits) - name.data(); }
+  };
+
+  struct movieRecord {
+    int offset;
+    string_view title;
+    char yearByte;             // years since 1900, exactly as stored
+    int numActors;
+    const int *cast;
+
+    int getYear() const { return 1900 + yearByte; }
+    size_t getSize() const { return (const char *) (cast + numActors) - title.data(); }
+    film getFilm() const { film f; f.title = title; f.year = getYear(); return f; }
+  };
+
+  /**
+   * Methods: getNumActors
+   *          getNumMovies
+   * ---------------------
+   * Self-explanatory.  Actors are indexed from 0 to getNumActors() - 1
+   * in sorted order of name, and movies from 0 to getNumMovies() - 1
+   * in sorted order of (title, year), just like operator< on films.
+   */
+
+  int getNumActors() const { return *(const int *) actorFile; }
+  int getNumMovies() const { return *(const int *) movieFile; }
+
+  /**
+   * Methods: getActorOffset
+   *          getMovieOffset
+   * -----------------------
+   * Returns the byte offset of the actor or movie record with the specified index.
+   */
+
+  int getActorOffset(int index) const { return ((const int *) actorFile)[index + 1]; }
+  int getMovieOffset(int index) const { return ((const int *) movieFile)[index + 1]; }
+
+  /**
+   * Methods: findActor
+   *          findMovie
+   * ------------------
+   * Searches for the specified actor/actress or movie without
+   * allocating any memory.
+   *
+   * @param stats counts the lookup, its probes and its string comparisons,
+   *              and the bytes of names compared, unless it's NULL.
+   * @return the index of the actor or movie, or -1 if it isn't in the database.
+   *         Actors and movies only in the delta have indexes from
+   *         getNumActors() and getNumMovies() upwards.
+   */
+
+  int findActor(string_view player, searchStats *stats = NULL) const;
+  int findMovie(string_view title, int year, searchStats *stats = NULL) const;
+
+  /**
+   * Methods: getActor
+   *          getMovie
+   * -----------------
+   * Decodes the record at the specified byte offset (as returned by getActorOffset,
+   * or as listed in the credits or cast of another record) into a view.  A view's
+   * getSize is the number of bytes the record spans, name (or title) included.
+   */
+
+  actorRecord getActor(int offset) const;
+  movieRecord getMovie(int offset) const;
+
+  /**
+   * Method: writeIndexes
+   * --------------------
+   * Builds a hash index over the actor names and another over the movie
+   * (title, year) pairs, and writes them into the specified directory as
+   * actorindex and movieindex (kActorIndexFileName and kMovieIndexFileName).  When the imdb constructor finds both files
+   * next to the data files they were built from, findActor and findMovie
+   * (and therefore getCredits and getCast) probe them instead of running
+   * a binary search.  Stale or foreign index files are simply ignored.
+   *
+   * @param directory the directory the index files should be written to,
+   *                  which should be the one housing the data files.
+   * @return true if and only if both index files were written.
+   */
+
+  bool writeIndexes(const string& directory) const;
+  static const char *const kActorIndexFileName;
+  static const char *const kMovieIndexFileName;
+
+  /**
+   * Predicate Method: indexed
+   * -------------------------
+   * Returns true if and only if lookups are being served by
+   * the hash indexes rather than by binary search.
+   */
+
+  bool indexed() const { return actorIndex != NULL && movieIndex != NULL; }
+
+  /**
+   * Predicate Method: converted
+   * ---------------------------
+   * Returns true if and only if the records are being served out of
+   * a converted data file rather than out of actordata and moviedata.
+   */
+
+  bool converted() const { return dataInfo.fileMap != NULL; }
+
+  /**
+   * Method: getDataSize
+   * -------------------
+   * Returns the number of bytes of actor and movie records (including
+   * the offset tables in front of them) backing the imdb, plus the number
+   * of bytes of the delta in use, so that it changes whenever the delta grows.
+   */
+
+  size_t getDataSize() const { return actorSize + movieSize + deltaSize; }
+
+  /**
+   * Methods: getActorDataSize
+   *          getMovieDataSize
+   * --------------------------
+   * Return the number of bytes of actor (or movie) records, including the
+   * offset table in front of them.  Every record offset is less than this,
+   * whatever order the records are laid out in.
+   */
+
+  size_t getActorDataSize() const { return actorSize; }
+  size_t getMovieDataSize() const { return movieSize; }
+
+  /**
+   * Delta
+   * -----
+   * The data files are sorted, immutable blobs, so movies released since they
+   * were built are appended to a small delta file instead, which the imdb maps
+   * alongside them.  Each entry in the delta is a movie and the names of some of
+   * its cast, any of which may already be in the data files or earlier in the
+   * delta: movies and actors new to the delta get indexes of their own, starting
+   * at getNumMovies() and getNumActors(), and the credits are merged in with the
+   * ones in the data files.  findActor, findMovie, getCredits and getCast all see
+   * the delta, as do getActorName and getFilm, but getActorOffset, getMovieOffset,
+   * getActor and getMovie only cover the records in the data files.  imdb-compact
+   * folds a delta into new data files.
+   */
+
+  struct deltaEntry {
+    film movie;
+    vector<string> cast;
+  };
+
+  /**
+   * Methods: getNumDeltaActors
+   *          getNumDeltaMovies
+   *          hasDelta
+   * --------------------------
+   * Return the number of actors and movies that are only in the delta, and
+   * whether there's a delta in use at all.
+   */
+
+  int getNumDeltaActors() const { return deltaActors.size(); }
+  int getNumDeltaMovies() const { return deltaMovies.size(); }
+  bool hasDelta() const { return deltaInfo.fileMap != NULL; }
+
+  /**
+   * Methods: getActorName
+   *          getFilm
+   * --------------------
+   * Decode the actor or movie with the specified index, whether it's in the data
+   * files or only in the delta.
+   */
+
+  string_view getActorName(int index) const;
+  film getFilm(int index) const;
+
+  /**
+   * Method: getDeltaCredits
+   * -----------------------
+   * Returns every credit the delta adds, as (actor index, movie index) pairs
+   * sorted by actor and then by movie, none of which is already in the data files.
+   */
+
+  const vector<pair<int, int> >& getDeltaCredits() const { return deltaCredits; }
+
+  /**
+   * Method: appendToDelta
+   * ---------------------
+   * Appends the specified movies to the delta in the specified directory, which
+   * should be the one housing the data files, creating the delta if need be.
+   * The entries are written with a single append, but that isn't atomic: an
+   * imdb opened on the directory mid-append may see only some of the new
+   * entries.  Every entry carries its length, though, and one that isn't all
+   * there is ignored, so readers only ever see whole entries.  This imdb
+   * doesn't see them until it's reopened.
+   *
+   * @return true if and only if every entry was appended: false if any is
+   *         malformed (no title, a year that can't be stored, an empty name),
+   *         if the delta there was written against other data, or if the write
+   *         fails.
+   */
+
+  bool appendToDelta(const string& directory, const vector<deltaEntry>& entries) const;
+
+  /**
+   * Constants: kDeltaFileName
+   *            kDeltaMagic
+   *            kDeltaVersion
+   * --------------------------
+   * A delta is a deltaHeader followed by any number of entries, each of which
+   * is an int holding the entry's length in bytes (a multiple of four, itself
+   * included), then the title, its '\0' and its year byte, padded out to a
+   * multiple of four bytes, an int count, and that many '\0'-terminated names,
+   * padded out to a multiple of four bytes.  Everything is in the byte order of
+   * the machine that wrote it.
+   */
+
+  static const char *const kDeltaFileName;
+  static const int kDeltaMagic = 0x41544c44; // "DLTA" on little-endian machines
+  static const int kDeltaVersion = 1;
+
+  struct deltaHeader {
+    int magic;
+    int version;
+    int byteOrder;            // kByteOrderMark, as written by the appending machine
+    int numActors;            // of the data files the delta was written against
+    int numMovies;
+    int reserved;
+  };
+
+  /**
+   * Methods: populate
+   *          warm
+   *          recordProfile
+   *          evict
+   * ----------------------
+   * Control how much of the data is paged in before the first query, which
+   * would otherwise page-fault its way through the files one page at a time.
+   * populate pages in every file backing the imdb, having first advised the
+   * kernel that they'll be read sequentially and that huge pages are welcome
+   * (where it supports either).  warm pages in only the offset tables, plus
+   * the pages listed in an access profile, if one is given.  recordProfile
+   * writes such a profile: a snapshot of which pages of the files are resident
+   * right now, which is worth taking at the end of a representative run that
+   * started with a cold page cache.  evict does the opposite of populate: it
+   * drops this process's mappings of every page and advises the kernel to
+   * discard the files' cached pages, so that the next access to any of them
+   * is as cold as the kernel allows (pages that other processes have mapped
+   * stay behind).
+   *
+   * @return true if and only if the profile could be read (or written), and
+   *         matches the files backing the imdb, or (for evict) if and only
+   *         if the kernel took the advice for every file.
+   */
+
+  void populate() const;
+  bool warm(const string& profileName = "") const;
+  bool recordProfile(const string& profileName) const;
+  bool evict() const;
+
+  /**
+   * Constants: kDataFileName
+   *            kDataMagic
+   *            kDataVersion
+   * -------------------------
+   * The name of a converted data file, and the magic number and version
+   * its header must carry.  A converted data file is a dataHeader, padded
+   * out to kDataAlignment bytes, followed by the actor section and then the
+   * movie section, each of which starts on a multiple of kDataAlignment.
+   * Each section is laid out like actordata or moviedata (a count, then a
+   * table of record offsets relative to the start of the section, then the
+   * records), except that in every record the name (and, for movies, the year
+   * byte) is padded out to a multiple of four bytes and followed by an int
+   * count, so the count and the offsets after it are always aligned.
+   */
+
+  static const char *const kDataFileName;
+  static const int kDataMagic = 0x42444d49; // "IMDB" on little-endian machines
+  static const int kDataVersion = 1;
+  static const int kDataAlignment = 64;
+
+  struct dataHeader {
+    int magic;
+    int version;
+    int byteOrder;            // kByteOrderMark, as written by the converting machine
+    int numActors;
+    int numMovies;
+    int reserved;
+    long long actorSection;   // offsets and sizes of the sections, in bytes
+    long long actorSectionSize;
+    long long movieSection;
+    long long movieSectionSize;
+  };
+  static const int kByteOrderMark = 0x01020304;
+
   /**
    * Destructor: ~imdb
    * -----------------
@@ -92,6 +443,44 @@ class imdb {
   static const char *const kMovieFileName;
   const void *actorFile;
   const void *movieFile;
+  size_t actorSize;
+  size_t movieSize;
+
+  // an index file is a header followed by numSlots slots, each holding the hash
+  // and the index of one record (or an index of -1 if the slot is empty).
+  struct indexHeader {
+    int magic;
+    int numRecords;
+    int dataSize;
+    int numSlots;
+  };
+  struct indexSlot {
+    unsigned int hash;
+    int index;
+  };
+  const indexHeader *actorIndex;
+  const indexHeader *movieIndex;
+
+  // without index files, lookups run over a search tree built at load time instead: the
+  // first 12 bytes of every key (the name, or the title followed by its year byte), packed
+  // big-endian so integer order is byte order, inline with the record offset and laid out in
+  // Eytzinger order.  indexes[k] is the position of entries[k] within the offset table.
+  struct prefixEntry {
+    unsigned long long high;
+    unsigned int low;
+    int offset;
+  };
+  struct searchTree {
+    int size;
+    prefixEntry *entries;
+    int *indexes;
+
+    void build(const void *file, int keyExtra);
+    void release();
+    int fill(const prefixEntry *sorted, int next, int k);
+    template <typename TieBreak>
+    int find(const prefixEntry& key, int keyLength, TieBreak compare, searchStats *stats) const;
+  } actorTree, movieTree;
   
   // everything below here is complicated and needn't be touched.
   // you're free to investigate, but you're on your own.
@@ -99,10 +488,34 @@ class imdb {
     int fd;
     size_t fileSize;
     const void *fileMap;
-  } actorInfo, movieInfo;
+  } actorInfo, movieInfo, actorIndexInfo, movieIndexInfo, dataInfo, deltaInfo;
+
+  // the delta, decoded at load time: the names of the actors and the titles and year bytes
+  // of the movies only it has (pointing into its map), indexes of both by name, and the
+  // credits it adds sorted both ways.
+  size_t deltaSize;
+  vector<string_view> deltaActors;
+  vector<pair<string_view, char> > deltaMovies;
+  unordered_map<string_view, int> deltaActorIndexes;
+  map<pair<string_view, char>, int> deltaMovieIndexes;
+  vector<pair<int, int> > deltaCredits;
+  vector<pair<int, int> > deltaCasts;
   
+  vector<const fileInfo *> getMaps() const;
+  int findDataActor(string_view player, searchStats *stats) const;
+  int findDataMovie(string_view title, int year, searchStats *stats) const;
+  void acquireDelta(const string& fileName);
+
+  // whether the actor offset table is in increasing order, so an offset's index can be
+  // found by binary search; checked the first time it's needed.
+  mutable once_flag actorOrderChecked;
+  mutable bool actorOffsetsAscending;
+  int getActorIndex(int offset) const;
   static const void *acquireFileMap(const string& fileName, struct fileInfo& info);
   static void releaseFileMap(struct fileInfo& info);
+  bool acquireData(const string& fileName);
+  static const indexHeader *acquireIndex(const struct fileInfo& info, const void *data, size_t dataSize);
+  static bool writeIndex(const string& fileName, const vector<unsigned int>& hashes, int dataSize);
 
   // marked as private so imdbs can't be copy constructed or reassigned.
   // if we were to allow this, we'd alias open files and accidentally close
@@ -0,0 +1,90 @@
+#include "k-shortest-paths.h"
+#include "search-filter.h"
+#include <algorithm>
+using namespace std;
+
+kShortestPaths::kShortestPaths(const imdbGraph& graph, int source, int target, const searchFilter *filter) :
+  graph(graph), filter(filter), source(source), target(target), numActors(graph.getNumActors()),
+  exhausted(filter != NULL && (!filter->allowsActor(source) || !filter->allowsActor(target))) {}
+
+/**
+ * Breadth-first search from the spur to the target, through nodes that aren't
+ * blocked and that the filter allows, and never straight from the spur to any
+ * of the forbidden nodes.
+ *
+ * @param nodes set to the path found, from the spur to the target inclusive.
+ * @return true if and only if a path was found.
+ */
+
+bool kShortestPaths::search(int spur, const vector<int>& forbidden, vector<int>& nodes)
+{
+  int numNodes = numActors + graph.getNumMovies();
+  reached.reset(numNodes);
+  if ((int) parent.size() < numNodes) parent.resize(numNodes);
+  reached.insert(spur);
+  vector<int> frontier(1, spur), next;
+  while (!frontier.empty() && !reached.contains(target)) {
+    next.clear();
+    for (int node: frontier) {
+      bool isActor = node < numActors;
+      int count;
+      const int *neighbours = isActor ? graph.getCredits(node, count) : graph.getCast(node - numActors, count);
+      for (int i = 0; i < count; i++) {
+        int neighbour = isActor ? neighbours[i] + numActors : neighbours[i];
+        if (reached.contains(neighbour) || blocked.contains(neighbour)) continue;
+        if (filter != NULL && !(isActor ? filter->allowsMovie(neighbours[i]) : filter->allowsActor(neighbour))) continue;
+        if (node == spur && find(forbidden.begin(), forbidden.end(), neighbour) != forbidden.end()) continue;
+        reached.insert(neighbour);
+        parent[neighbour] = node;
+        next.push_back(neighbour);
+      }
+    }
+    frontier.swap(next);
+  }
+  if (!reached.contains(target)) return false;
+
+  nodes.clear();
+  for (int node = target; node != spur; node = parent[node]) nodes.push_back(node);
+  nodes.push_back(spur);
+  reverse(nodes.begin(), nodes.end());
+  return true;
+}
+
+bool kShortestPaths::next(vector<imdbGraph::link>& links)
+{
+  if (exhausted) return false;
+  int numNodes = numActors + graph.getNumMovies();
+  vector<int> nodes;
+  if (produced.empty()) {
+    blocked.reset(numNodes);
+    exhausted = !search(source, vector<int>(), nodes);
+  } else {
+    // spur off every node of the last path produced but the target
+    const vector<int>& last = produced.back();
+    for (size_t spur = 0; spur + 1 < last.size(); spur++) {
+      blocked.reset(numNodes);
+      for (size_t i = 0; i < spur; i++) blocked.insert(last[i]);
+      vector<int> forbidden;
+      for (const vector<int>& earlier: produced) {
+        if (earlier.size() > spur + 1 && equal(last.begin(), last.begin() + spur + 1, earlier.begin()))
+          forbidden.push_back(earlier[spur + 1]);
+      }
+      vector<int> onward;
+      if (!search(last[spur], forbidden, onward)) continue;
+      vector<int> candidate(last.begin(), last.begin() + spur);
+      candidate.insert(candidate.end(), onward.begin(), onward.end());
+      candidates.insert(make_pair(candidate.size(), candidate));
+    }
+    exhausted = candidates.empty();
+    if (!exhausted) {
+      nodes = candidates.begin()->second;
+      candidates.erase(candidates.begin());
+    }
+  }
+  if (exhausted) return false;
+
+  produced.push_back(nodes);
+  links.clear();
+  for (size_t i = 1; i + 1 < nodes.size(); i += 2) links.push_back({nodes[i] - numActors, nodes[i + 1]});
+  return true;
+}
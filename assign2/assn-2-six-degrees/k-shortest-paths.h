@@ -0,0 +1,81 @@
+#ifndef __k_shortest_paths__
+#define __k_shortest_paths__
+
+#include "imdb-graph.h"
+#include "visited-set.h"
+#include <set>
+#include <utility>
+#include <vector>
+using namespace std;
+
+class searchFilter;
+
+/**
+ * Class: kShortestPaths
+ * ---------------------
+ * The simple paths between two actors, handed out one at a time in order of
+ * length, so the first k of them are the k shortest.  A simple path never
+ * passes through the same actor or the same movie twice.
+ *
+ * This is Yen's algorithm over the bipartite graph of actors and movies.  Each
+ * path after the first is found by taking some path already produced, keeping
+ * it up to one of its nodes (the spur), and searching for the shortest way on
+ * from there that leaves the spur by an edge no earlier path with the same
+ * prefix took, and that doesn't revisit the prefix.  Every such candidate is
+ * kept in a set ordered by length, and the shortest is the next path.  So the
+ * cost of each path is one breadth-first search per node of the path before
+ * it, and the memory is the paths produced plus the candidates pending.
+ *
+ * For the shortest paths alone, shortestPaths is far cheaper.
+ */
+
+class kShortestPaths {
+
+ public:
+
+  /**
+   * Constructor: kShortestPaths
+   * ---------------------------
+   * Prepares to enumerate the simple paths from source to target through
+   * movies and actors the filter allows (or through any of them, if the
+   * filter is NULL).  The graph and the filter must outlive the object.
+   * No searching happens until next is called.
+   */
+
+  kShortestPaths(const imdbGraph& graph, int source, int target, const searchFilter *filter = NULL);
+
+  /**
+   * Method: next
+   * ------------
+   * Produces the legs of the next shortest simple path (see imdbGraph::decodePath).
+   *
+   * @return true if there was another path, and false once they've all been produced.
+   */
+
+  bool next(vector<imdbGraph::link>& links);
+
+ private:
+  const imdbGraph& graph;
+  const searchFilter *filter;
+  int source;
+  int target;
+  int numActors;
+
+  // paths are sequences of nodes: actor ids as they are, and movie ids offset by numActors
+  vector<vector<int> > produced;
+  set<pair<size_t, vector<int> > > candidates;
+  bool exhausted;
+
+  // per-search scratch, reused by every search
+  visitedSet blocked;
+  visitedSet reached;
+  vector<int> parent;
+
+  bool search(int spur, const vector<int>& forbidden, vector<int>& nodes);
+
+  // marked as private so enumerations can't be copy constructed or reassigned.
+  kShortestPaths(const kShortestPaths& original);
+  kShortestPaths& operator=(const kShortestPaths& rhs);
+};
+
+#endif
@@ -0,0 +1,107 @@
+#include "landmark-table.h"
+#include <algorithm>
+#include <cstdlib>
+using namespace std;
+
+static const int kTableMagic = 0x4b4e414c; // "LANK" on little-endian machines
+
+landmarkTable::landmarkTable(const imdbGraph& graph, int numLandmarks, int numThreads) : mapped(NULL)
+{
+  int numActors = graph.getNumActors();
+  numLandmarks = max(0, min(numLandmarks, numActors));
+  vector<int> byCredits(numActors);
+  for (int i = 0; i < numActors; i++) byCredits[i] = i;
+  partial_sort(byCredits.begin(), byCredits.begin() + numLandmarks, byCredits.end(), [&](int a, int b) {
+    int creditsA = graph.getNumCredits(a), creditsB = graph.getNumCredits(b);
+    return creditsA != creditsB ? creditsA > creditsB : a < b;
+  });
+
+  built.resize(tableSize(numActors, numLandmarks));
+  tableHeader *table = (tableHeader *) built.data();
+  table->magic = kTableMagic;
+  table->numActors = numActors;
+  table->numMovies = graph.getNumMovies();
+  table->numCredits = graph.getNumCredits();
+  table->numLandmarks = numLandmarks;
+  table->reserved = 0;
+  table->dataSize = graph.getDataSize();
+
+  int *tableLandmarks = (int *) (table + 1);
+  unsigned char *tableDistances = (unsigned char *) (tableLandmarks + numLandmarks);
+  vector<int> distance;
+  vector<imdbGraph::link> parent;
+  for (int l = 0; l < numLandmarks; l++) {
+    tableLandmarks[l] = byCredits[l];
+    graph.breadthFirstSearch(byCredits[l], -1, numThreads, distance, parent);
+    for (int i = 0; i < numActors; i++)
+      tableDistances[i * numLandmarks + l] =
+        distance[i] == -1 ? kUnreachable : min(distance[i], kUnreachable - 1);
+  }
+  attach(built.data());
+}
+
+landmarkTable::landmarkTable(const imdbGraph& graph, const string& fileName) : header(NULL)
+{
+  mapped = new mappedFile(fileName);
+  const tableHeader *table = (const tableHeader *) mapped->data();
+  if (table == NULL || mapped->size() < sizeof(tableHeader)) return;
+  if (table->magic != kTableMagic || table->numActors != graph.getNumActors() ||
+      table->numMovies != graph.getNumMovies() || table->numCredits != graph.getNumCredits() ||
+      table->dataSize != (long long) graph.getDataSize() ||
+      table->numLandmarks < 0 || table->numLandmarks > table->numActors ||
+      mapped->size() != tableSize(table->numActors, table->numLandmarks)) return;
+  const int *tableLandmarks = (const int *) (table + 1);
+  for (int l = 0; l < table->numLandmarks; l++)
+    if (tableLandmarks[l] < 0 || tableLandmarks[l] >= table->numActors) return;
+  attach((const char *) table);
+}
+
+size_t landmarkTable::tableSize(int numActors, int numLandmarks)
+{
+  return sizeof(tableHeader) + numLandmarks * (sizeof(int) + (size_t) numActors);
+}
+
+void landmarkTable::attach(const char *table)
+{
+  header = (const tableHeader *) table;
+  landmarks = (const int *) (header + 1);
+  distances = (const unsigned char *) (landmarks + header->numLandmarks);
+}
+
+landmarkTable::~landmarkTable()
+{
+  delete mapped;
+}
+
+bool landmarkTable::save(const string& fileName) const
+{
+  return mappedFile::writeAtomically(fileName, header, tableSize(header->numActors, header->numLandmarks));
+}
+
+bool landmarkTable::getBounds(int source, int target, int& lower, int& upper) const
+{
+  const unsigned char *fromSource = getDistances(source), *fromTarget = getDistances(target);
+  lower = 0;
+  upper = kUnbounded;
+  for (int l = 0; l < header->numLandmarks; l++) {
+    bool reachesSource = fromSource[l] != kUnreachable, reachesTarget = fromTarget[l] != kUnreachable;
+    if (reachesSource != reachesTarget) return false;
+    if (!reachesSource) continue;
+    lower = max(lower, abs(fromSource[l] - fromTarget[l]));
+    upper = min(upper, fromSource[l] + fromTarget[l]);
+  }
+  if (source == target) upper = 0;
+  return true;
+}
+
+int landmarkTable::getLowerBound(int actor, const unsigned char *target) const
+{
+  const unsigned char *fromActor = getDistances(actor);
+  int lower = 0;
+  for (int l = 0; l < header->numLandmarks; l++) {
+    if (fromActor[l] == target[l]) continue;
+    if (fromActor[l] == kUnreachable || target[l] == kUnreachable) return kUnbounded;
+    lower = max(lower, abs(fromActor[l] - target[l]));
+  }
+  return lower;
+}
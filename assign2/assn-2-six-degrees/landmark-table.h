@@ -0,0 +1,144 @@
+#ifndef __landmark_table__
+#define __landmark_table__
+
+#include "imdb-graph.h"
+#include "mapped-file.h"
+#include <string>
+#include <vector>
+using namespace std;
+
+/**
+ * Class: landmarkTable
+ * --------------------
+ * A distance oracle built from a handful of landmark actors (the ones with
+ * the most credits): the table records the exact distance from every landmark
+ * to every actor, and the triangle inequality turns those into bounds on the
+ * distance between any two actors s and t.  For every landmark L,
+ *
+ *     |d(L, s) - d(L, t)|  <=  d(s, t)  <=  d(L, s) + d(L, t)
+ *
+ * and if L reaches exactly one of s and t, the two can't be connected at all.
+ *
+ * Distances are stored one byte apiece, actor-major, so the distances from
+ * all of the landmarks to a single actor share a cache line.  On disk, a
+ * table is a header, followed by the ids of the landmarks, followed by the
+ * distance bytes (kUnreachable where a landmark doesn't reach an actor).
+ */
+
+class landmarkTable {
+
+ public:
+
+  /**
+   * Constructor: landmarkTable
+   * --------------------------
+   * Builds the table by choosing the numLandmarks actors with the most credits
+   * and searching the entire graph out of each of them, with every level of
+   * every search spread across numThreads threads.
+   */
+
+  landmarkTable(const imdbGraph& graph, int numLandmarks, int numThreads);
+
+  /**
+   * Constructor: landmarkTable
+   * --------------------------
+   * Maps a table previously saved to the specified file.  If the file is
+   * missing, or was built from a graph other than the one specified, then
+   * good() returns false and the table shouldn't be used.
+   */
+
+  landmarkTable(const imdbGraph& graph, const string& fileName);
+
+  /**
+   * Methods: good
+   *          save
+   *          getNumLandmarks
+   *          getLandmark
+   * -------------------------
+   * Self-explanatory, and the same as baconTable's.
+   */
+
+  bool good() const { return header != NULL; }
+  bool save(const string& fileName) const;
+  int getNumLandmarks() const { return header->numLandmarks; }
+  int getLandmark(int i) const { return landmarks[i]; }
+
+  /**
+   * Constant: kFileName
+   * -------------------
+   * The name the table is saved under in a data directory, where six-degrees --landmarks looks for it and saves it.
+   */
+
+  static constexpr const char *kFileName = "landmarks";
+
+  /**
+   * Method: getBounds
+   * -----------------
+   * Bounds the distance (in movies) between the two actors.
+   *
+   * @param lower set to the largest lower bound any landmark provides.
+   * @param upper set to the smallest upper bound any landmark provides,
+   *              or kUnbounded if no landmark reaches both actors.
+   * @return false if some landmark proves that there's no path between
+   *         the two actors, and true otherwise.
+   */
+
+  bool getBounds(int source, int target, int& lower, int& upper) const;
+
+  /**
+   * Method: getLowerBound
+   * ---------------------
+   * Same as the lower bound provided by getBounds, but cheaper: target
+   * is the target's row of distances, as returned by getDistances, so
+   * that searches pruning against a single target only fetch it once.
+   */
+
+  int getLowerBound(int actor, const unsigned char *target) const;
+  const unsigned char *getDistances(int actor) const { return distances + actor * header->numLandmarks; }
+
+  /**
+   * Constants: kUnreachable
+   *            kUnbounded
+   * ------------------------
+   * kUnreachable is the distance byte stored where a landmark doesn't reach
+   * an actor, and kUnbounded is the upper bound getBounds reports when no
+   * landmark reaches both actors.
+   */
+
+  static const unsigned char kUnreachable = 255;
+  static const int kUnbounded = 1 << 30;
+
+  /**
+   * Destructor: ~landmarkTable
+   * --------------------------
+   * Releases the table, unmapping it if it was mapped from a file.
+   */
+
+  ~landmarkTable();
+
+ private:
+  struct tableHeader {
+    int magic;
+    int numActors;
+    int numMovies;
+    int numCredits;
+    int numLandmarks;
+    int reserved;
+    long long dataSize;         // imdb::getDataSize of the data the table was built from
+  };
+
+  const tableHeader *header;
+  const int *landmarks;
+  const unsigned char *distances;
+  vector<char> built;
+  mappedFile *mapped;
+
+  void attach(const char *table);
+  static size_t tableSize(int numActors, int numLandmarks);
+
+  // marked as private so tables can't be copy constructed or reassigned.
+  landmarkTable(const landmarkTable& original);
+  landmarkTable& operator=(const landmarkTable& rhs);
+};
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef __lru_cache__
+#define __lru_cache__
+
+#include <atomic>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+using namespace std;
+
+/**
+ * Class: lruCache
+ * ---------------
+ * A thread-safe map from keys to values that holds at most a fixed number
+ * of bytes' worth of entries, evicting the least recently used entries to
+ * make room for new ones.  Each entry's size is whatever the client says it
+ * is when putting it, so the cap is only as accurate as those estimates.
+ *
+ * Entries are spread over kNumShards independent shards by the hash of
+ * their keys, each with its own lock, recency list and share of the cap,
+ * so threads looking up different keys rarely contend.  Values are copied
+ * in and out under the lock, so large values should be held by shared_ptr.
+ *
+ * Hits and misses are counted, so that the cache can be sized by watching
+ * how the hit rate responds to the cap.
+ */
+
+template <typename Key, typename Value, typename Hash = hash<Key> >
+class lruCache {
+
+ public:
+
+  /**
+   * Constructor: lruCache
+   * ---------------------
+   * Creates an empty cache holding at most capacity bytes.
+   */
+
+  lruCache(size_t capacity) : capacity(capacity), hits(0), misses(0), evictions(0) {}
+
+  /**
+   * Method: get
+   * -----------
+   * Looks up the specified key, marking its entry as the most recently used.
+   *
+   * @return true, with value set to the entry's value, if the key is cached,
+   *         and false otherwise.
+   */
+
+  bool get(const Key& key, Value& value) {
+    shard& s = shardOf(key);
+    lock_guard<mutex> guard(s.lock);
+    typename unordered_map<Key, typename entryList::iterator, Hash>::iterator found = s.index.find(key);
+    if (found == s.index.end()) {
+      misses++;
+      return false;
+    }
+    s.entries.splice(s.entries.begin(), s.entries, found->second);
+    value = found->second->value;
+    hits++;
+    return true;
+  }
+
+  /**
+   * Method: put
+   * -----------
+   * Caches the specified value, which takes up roughly the specified number of
+   * bytes, under the specified key, replacing any value already there and
+   * evicting least recently used entries until the shard is back under its
+   * share of the cap.  Values larger than a shard's share aren't cached at all.
+   */
+
+  void put(const Key& key, const Value& value, size_t bytes) {
+    shard& s = shardOf(key);
+    size_t cap = capacity / kNumShards;
+    if (bytes > cap) return;
+    lock_guard<mutex> guard(s.lock);
+    typename unordered_map<Key, typename entryList::iterator, Hash>::iterator found = s.index.find(key);
+    if (found != s.index.end()) {
+      s.bytes -= found->second->bytes;
+      s.entries.erase(found->second);
+      s.index.erase(found);
+    }
+    while (!s.entries.empty() && s.bytes + bytes > cap) {
+      s.bytes -= s.entries.back().bytes;
+      s.index.erase(s.entries.back().key);
+      s.entries.pop_back();
+      evictions++;
+    }
+    s.entries.push_front(entry{key, value, bytes});
+    s.index[key] = s.entries.begin();
+    s.bytes += bytes;
+  }
+
+  /**
+   * Methods: getCapacity
+   *          getHits
+   *          getMisses
+   *          getEvictions
+   *          getNumEntries
+   *          getBytes
+   * ----------------------
+   * Self-explanatory.  The counts cover the cache's whole lifetime, and
+   * getBytes totals the sizes the entries were put with.
+   */
+
+  size_t getCapacity() const { return capacity; }
+  long long getHits() const { return hits; }
+  long long getMisses() const { return misses; }
+  long long getEvictions() const { return evictions; }
+
+  size_t getNumEntries() const {
+    size_t total = 0;
+    for (const shard& s: shards) {
+      lock_guard<mutex> guard(s.lock);
+      total += s.entries.size();
+    }
+    return total;
+  }
+
+  size_t getBytes() const {
+    size_t total = 0;
+    for (const shard& s: shards) {
+      lock_guard<mutex> guard(s.lock);
+      total += s.bytes;
+    }
+    return total;
+  }
+
+ private:
+  static const int kNumShards = 16;
+
+  struct entry {
+    Key key;
+    Value value;
+    size_t bytes;
+  };
+
+  typedef list<entry> entryList;
+
+  struct shard {
+    mutable mutex lock;
+    entryList entries;         // most recently used first
+    unordered_map<Key, typename entryList::iterator, Hash> index;
+    size_t bytes = 0;
+  };
+
+  size_t capacity;
+  shard shards[kNumShards];
+  atomic<long long> hits;
+  atomic<long long> misses;
+  atomic<long long> evictions;
+
+  shard& shardOf(const Key& key) {
+    // some hashes (of ints, say) are the key itself, so the hash is mixed before it's split
+    unsigned long long h = Hash()(key) * 0x9e3779b97f4a7c15ULL;
+    return shards[(h >> 32) % kNumShards];
+  }
+
+  // marked as private so caches can't be copy constructed or reassigned.
+  lruCache(const lruCache& original);
+  lruCache& operator=(const lruCache& rhs);
+};
+
+#endif
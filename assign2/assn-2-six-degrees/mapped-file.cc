@@ -0,0 +1,46 @@
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include "mapped-file.h"
+using namespace std;
+
+mappedFile::mappedFile(const string& fileName) : fileSize(0), fileMap(NULL)
+{
+  struct stat stats;
+  fd = open(fileName.c_str(), O_RDONLY);
+  if (fd == -1 || fstat(fd, &stats) == -1 || stats.st_size == 0) return;
+  fileSize = stats.st_size;
+  void *map = mmap(0, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+  if (map != MAP_FAILED) fileMap = map;
+}
+
+mappedFile::~mappedFile()
+{
+  if (fileMap != NULL) munmap((char *) fileMap, fileSize);
+  if (fd != -1) close(fd);
+}
+
+bool mappedFile::writeAtomically(const string& fileName, const void *bytes, size_t numBytes)
+{
+  // a temporary file of our own, in the same directory so that the rename stays on one file system
+  string tempName = fileName + ".XXXXXX";
+  int out = mkstemp(&tempName[0]);
+  if (out == -1) return false;
+  bool written = fchmod(out, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH) == 0;
+  for (size_t done = 0; written && done < numBytes; ) {
+    ssize_t count = write(out, (const char *) bytes + done, numBytes - done);
+    if (count > 0) done += count;
+    else if (count == -1 && errno == EINTR) continue;
+    else written = false;
+  }
+  if (close(out) != 0 || !written || rename(tempName.c_str(), fileName.c_str()) != 0) {
+    remove(tempName.c_str());
+    return false;
+  }
+  return true;
+}
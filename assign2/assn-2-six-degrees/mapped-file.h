@@ -0,0 +1,76 @@
+#ifndef __mapped_file__
+#define __mapped_file__
+
+#include <string>
+using namespace std;
+
+/**
+ * Class: mappedFile
+ * -----------------
+ * Maps an entire file into memory, read-only, for as long as the
+ * mappedFile is alive.  This is the same UNIXy trick the imdb uses
+ * to make actordata and moviedata look like arrays of bytes in RAM,
+ * packaged up for the various tables that sit next to them.
+ */
+
+class mappedFile {
+
+ public:
+
+  /**
+   * Constructor: mappedFile
+   * -----------------------
+   * Maps the specified file.  If the file doesn't exist or can't be
+   * read or mapped, then the mappedFile is constructed anyway, but
+   * good() returns false.
+   *
+   * @param fileName the name of the file to be mapped.
+   */
+
+  mappedFile(const string& fileName);
+
+  /**
+   * Methods: good
+   *          data
+   *          size
+   * --------------
+   * Self-explanatory.  data() is NULL unless good() is true.
+   */
+
+  bool good() const { return fileMap != NULL; }
+  const void *data() const { return fileMap; }
+  size_t size() const { return fileSize; }
+
+  /**
+   * Destructor: ~mappedFile
+   * -----------------------
+   * Unmaps and closes the file.
+   */
+
+  ~mappedFile();
+
+  /**
+   * Static Method: writeAtomically
+   * ------------------------------
+   * Writes the specified bytes to a temporary file and renames it over the
+   * specified file name, so that anyone mapping the file concurrently sees
+   * either the old contents or the new ones, but never a partial write.  The
+   * temporary file gets a name of its own (see mkstemp), so two processes
+   * writing the same file at once each rename a complete copy into place.
+   *
+   * @return true if and only if the file was written.
+   */
+
+  static bool writeAtomically(const string& fileName, const void *bytes, size_t numBytes);
+
+ private:
+  int fd;
+  size_t fileSize;
+  const void *fileMap;
+
+  // marked as private so that mappings can't be aliased (same as imdb).
+  mappedFile(const mappedFile& original);
+  mappedFile& operator=(const mappedFile& rhs);
+};
+
+#endif
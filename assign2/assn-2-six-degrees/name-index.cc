@@ -0,0 +1,293 @@
+#include "name-index.h"
+#include <algorithm>
+#include <queue>
+using namespace std;
+
+static const int kIndexMagic = 0x454d414e; // "NAME" on little-endian machines
+
+/**
+ * Names are compared a byte at a time with ASCII letters folded to lower case,
+ * and bytes compared as unsigned, so the sorted order splits cleanly by byte.
+ */
+
+static inline unsigned char fold(char c)
+{
+  return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : (unsigned char) c;
+}
+
+static bool foldedLess(string_view a, string_view b)
+{
+  size_t length = min(a.size(), b.size());
+  for (size_t i = 0; i < length; i++)
+    if (fold(a[i]) != fold(b[i])) return fold(a[i]) < fold(b[i]);
+  return a.size() < b.size();
+}
+
+/**
+ * Compares the start of the name with the prefix: negative if the name sorts
+ * before every name starting with the prefix, zero if it starts with the
+ * prefix, and positive if it sorts after every such name.
+ */
+
+static int comparePrefix(string_view name, string_view prefix)
+{
+  size_t length = min(name.size(), prefix.size());
+  for (size_t i = 0; i < length; i++)
+    if (fold(name[i]) != fold(prefix[i])) return fold(name[i]) < fold(prefix[i]) ? -1 : 1;
+  return name.size() < prefix.size() ? -1 : 0;
+}
+
+/**
+ * The more popular of two positions (or the earlier, if they're equally
+ * popular), where -1 stands for no position at all.
+ */
+
+static inline int better(const int *scores, int a, int b)
+{
+  if (a == -1) return b;
+  if (b == -1) return a;
+  return scores[b] > scores[a] || (scores[b] == scores[a] && b < a) ? b : a;
+}
+
+nameIndex::nameIndex(const imdb& db) : db(db), mapped(NULL)
+{
+  int numActors = db.getNumActors(), numMovies = db.getNumMovies();
+  built.resize(indexSize(numActors, numMovies));
+  indexHeader *index = (indexHeader *) built.data();
+  index->magic = kIndexMagic;
+  index->numActors = numActors;
+  index->numMovies = numMovies;
+  index->reserved = 0;
+  index->dataSize = db.getDataSize();
+  int *actorArrays = (int *) (index + 1);
+  int *movieArrays = actorArrays + 4 * (size_t) numActors;
+  build(db, false, actorArrays, actorArrays + numActors, actorArrays + 2 * (size_t) numActors);
+  build(db, true, movieArrays, movieArrays + numMovies, movieArrays + 2 * (size_t) numMovies);
+  attach(built.data());
+}
+
+void nameIndex::build(const imdb& db, bool movies, int *order, int *scores, int *tree)
+{
+  int size = movies ? db.getNumMovies() : db.getNumActors();
+  vector<string_view> names(size);
+  vector<int> popularity(size);
+  for (int i = 0; i < size; i++) {
+    if (movies) {
+      imdb::movieRecord movie = db.getMovie(db.getMovieOffset(i));
+      names[i] = movie.title;
+      popularity[i] = movie.numActors;
+    } else {
+      imdb::actorRecord actor = db.getActor(db.getActorOffset(i));
+      names[i] = actor.name;
+      popularity[i] = actor.numCredits;
+    }
+  }
+
+  for (int i = 0; i < size; i++) order[i] = i;
+  stable_sort(order, order + size, [&](int a, int b) { return foldedLess(names[a], names[b]); });
+  for (int i = 0; i < size; i++) {
+    scores[i] = popularity[order[i]];
+    tree[size + i] = i;
+  }
+  for (int j = size - 1; j > 0; j--) tree[j] = better(scores, tree[2 * j], tree[2 * j + 1]);
+  if (size > 0) tree[0] = 0; // never used
+}
+
+nameIndex::nameIndex(const imdb& db, const string& fileName) : db(db), header(NULL)
+{
+  mapped = new mappedFile(fileName);
+  const indexHeader *index = (const indexHeader *) mapped->data();
+  if (index == NULL || mapped->size() < sizeof(indexHeader)) return;
+  if (index->magic != kIndexMagic || index->numActors != db.getNumActors() ||
+      index->numMovies != db.getNumMovies() || index->dataSize != (long long) db.getDataSize() ||
+      mapped->size() != indexSize(index->numActors, index->numMovies)) return;
+
+  // every order entry names a record, and every tree entry a position
+  const int *arrays = (const int *) (index + 1);
+  for (int side = 0; side < 2; side++) {
+    int size = side == 0 ? index->numActors : index->numMovies;
+    for (int i = 0; i < size; i++)
+      if (arrays[i] < 0 || arrays[i] >= size) return;
+    for (int i = 0; i < 2 * size; i++)
+      if (arrays[2 * size + i] < 0 || arrays[2 * size + i] >= size) return;
+    arrays += 4 * (size_t) size;
+  }
+  attach((const char *) index);
+}
+
+size_t nameIndex::indexSize(int numActors, int numMovies)
+{
+  return sizeof(indexHeader) + 4 * ((size_t) numActors + numMovies) * sizeof(int);
+}
+
+void nameIndex::attach(const char *index)
+{
+  header = (const indexHeader *) index;
+  const int *arrays = (const int *) (header + 1);
+  actors = kind{header->numActors, arrays, arrays + header->numActors, arrays + 2 * (size_t) header->numActors, false};
+  arrays += 4 * (size_t) header->numActors;
+  movies = kind{header->numMovies, arrays, arrays + header->numMovies, arrays + 2 * (size_t) header->numMovies, true};
+}
+
+nameIndex::~nameIndex()
+{
+  delete mapped;
+}
+
+bool nameIndex::save(const string& fileName) const
+{
+  return mappedFile::writeAtomically(fileName, header, indexSize(header->numActors, header->numMovies));
+}
+
+string_view nameIndex::getName(const kind& k, int position) const
+{
+  int record = k.order[position];
+  return k.movies ? db.getMovie(db.getMovieOffset(record)).title : db.getActor(db.getActorOffset(record)).name;
+}
+
+void nameIndex::findPrefix(const kind& k, string_view prefix, int& lo, int& hi) const
+{
+  int first = 0, last = k.size;
+  while (first < last) {
+    int middle = first + (last - first) / 2;
+    if (comparePrefix(getName(k, middle), prefix) < 0) first = middle + 1;
+    else last = middle;
+  }
+  lo = first;
+  last = k.size;
+  while (first < last) {
+    int middle = first + (last - first) / 2;
+    if (comparePrefix(getName(k, middle), prefix) <= 0) first = middle + 1;
+    else last = middle;
+  }
+  hi = first;
+}
+
+/**
+ * The most popular position in [lo, hi), climbing the tree from both ends.
+ */
+
+int nameIndex::best(const kind& k, int lo, int hi) const
+{
+  int result = -1;
+  for (lo += k.size, hi += k.size; lo < hi; lo >>= 1, hi >>= 1) {
+    if (lo & 1) result = better(k.scores, result, k.tree[lo++]);
+    if (hi & 1) result = better(k.scores, result, k.tree[--hi]);
+  }
+  return result;
+}
+
+/**
+ * Draws the n most popular positions out of the prefix's range, most popular
+ * first: the best of the whole range, and then repeatedly the best of the
+ * pieces left either side of each position already drawn.
+ */
+
+void nameIndex::complete(const kind& k, string_view prefix, int n, vector<int>& ids) const
+{
+  ids.clear();
+  int lo, hi;
+  findPrefix(k, prefix, lo, hi);
+  struct piece {
+    int score;
+    int position;
+    int lo;
+    int hi;
+    bool operator<(const piece& other) const {
+      return score < other.score || (score == other.score && position > other.position);
+    }
+  };
+  priority_queue<piece> pieces;
+  auto add = [&](int lo, int hi) {
+    if (lo >= hi) return;
+    int position = best(k, lo, hi);
+    pieces.push(piece{k.scores[position], position, lo, hi});
+  };
+  add(lo, hi);
+  while ((int) ids.size() < n && !pieces.empty()) {
+    piece top = pieces.top();
+    pieces.pop();
+    ids.push_back(k.order[top.position]);
+    add(top.lo, top.position);
+    add(top.position + 1, top.hi);
+  }
+}
+
+void nameIndex::completeActors(string_view prefix, int n, vector<int>& ids) const
+{
+  complete(actors, prefix, n, ids);
+}
+
+void nameIndex::completeMovies(string_view prefix, int n, vector<int>& ids) const
+{
+  complete(movies, prefix, n, ids);
+}
+
+/**
+ * Visits the names in [lo, hi), which all share a prefix of depth characters
+ * whose row of the edit-distance table against the folded name is rows[depth].
+ * Names that are exactly the prefix come first, and are matches if the row
+ * ends within the distance allowed.  The rest split into ranges by their next
+ * character, and each range is visited in turn unless its row shows that no
+ * name in it can be within the distance allowed.
+ */
+
+void nameIndex::walk(const kind& k, const string& name, int lo, int hi, int depth, int maxDistance,
+                     vector<vector<int> >& rows, vector<pair<int, int> >& found) const
+{
+  int length = name.size();
+  int position = lo;
+  for (; position < hi && (int) getName(k, position).size() == depth; position++)
+    if (rows[depth][length] <= maxDistance) found.push_back(make_pair(rows[depth][length], position));
+
+  if ((int) rows.size() <= depth + 1) rows.resize(depth + 2, vector<int>(length + 1));
+  while (position < hi) {
+    unsigned char c = fold(getName(k, position)[depth]);
+    int first = position + 1, last = hi;
+    while (first < last) {
+      int middle = first + (last - first) / 2;
+      if (fold(getName(k, middle)[depth]) <= c) first = middle + 1;
+      else last = middle;
+    }
+
+    const vector<int>& row = rows[depth];
+    vector<int>& next = rows[depth + 1];
+    next[0] = row[0] + 1;
+    int smallest = next[0];
+    for (int j = 1; j <= length; j++) {
+      next[j] = min(min(row[j], next[j - 1]) + 1, row[j - 1] + ((unsigned char) name[j - 1] != c));
+      smallest = min(smallest, next[j]);
+    }
+    if (smallest <= maxDistance) walk(k, name, position, first, depth + 1, maxDistance, rows, found);
+    position = first;
+  }
+}
+
+void nameIndex::suggest(const kind& k, string_view name, int n, vector<int>& ids, int maxDistance) const
+{
+  ids.clear();
+  string folded(name.size(), '\0');
+  for (size_t i = 0; i < name.size(); i++) folded[i] = fold(name[i]);
+  if (maxDistance < 0) maxDistance = name.size() <= 2 ? 0 : name.size() <= 5 ? 1 : 2;
+
+  vector<vector<int> > rows(1, vector<int>(folded.size() + 1));
+  for (size_t j = 0; j <= folded.size(); j++) rows[0][j] = j;
+  vector<pair<int, int> > found;
+  walk(k, folded, 0, k.size, 0, maxDistance, rows, found);
+
+  sort(found.begin(), found.end(), [&](const pair<int, int>& a, const pair<int, int>& b) {
+    if (a.first != b.first) return a.first < b.first;
+    return better(k.scores, a.second, b.second) == a.second && a.second != b.second;
+  });
+  for (int i = 0; i < min(n, (int) found.size()); i++) ids.push_back(k.order[found[i].second]);
+}
+
+void nameIndex::suggestActors(string_view name, int n, vector<int>& ids, int maxDistance) const
+{
+  suggest(actors, name, n, ids, maxDistance);
+}
+
+void nameIndex::suggestMovies(string_view name, int n, vector<int>& ids, int maxDistance) const
+{
+  suggest(movies, name, n, ids, maxDistance);
+}
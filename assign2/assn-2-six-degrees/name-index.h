@@ -0,0 +1,160 @@
+#ifndef __name_index__
+#define __name_index__
+
+#include "imdb.h"
+#include "mapped-file.h"
+#include <string>
+#include <string_view>
+#include <vector>
+using namespace std;
+
+/**
+ * Class: nameIndex
+ * ----------------
+ * Completes and corrects actor names and movie titles, ignoring case.  For
+ * each of the two kinds of record, the index holds the record indexes sorted
+ * by case-folded name, each record's popularity (its number of credits, or the
+ * size of its cast), and a tree over those popularities that finds the most
+ * popular record in any range of the sorted order in logarithmic time.
+ *
+ * A prefix is a range of the sorted order, found by binary search, and the top
+ * n completions are drawn out of the range with the tree, in order of
+ * popularity, without looking at the rest of it.  The sorted order is also a
+ * trie in all but name: every set of names sharing a prefix is a range, and
+ * the range splits by next letter with a binary search.  Fuzzy lookups walk
+ * that implicit trie carrying a row of the edit-distance table, and abandon
+ * any prefix whose row shows it can't be within the distance allowed, which
+ * amounts to running a Levenshtein automaton over the trie.
+ *
+ * Names themselves are never copied into the index: they're read out of the
+ * imdb's records, so the index costs four ints per record.  On disk, an index
+ * is a header followed by the sorted order, the popularities and the tree for
+ * actors, and then the same three for movies.
+ */
+
+class nameIndex {
+
+ public:
+
+  /**
+   * Constructor: nameIndex
+   * ----------------------
+   * Builds the index over every actor and movie in the specified imdb, which
+   * must outlive the index.
+   */
+
+  nameIndex(const imdb& db);
+
+  /**
+   * Constructor: nameIndex
+   * ----------------------
+   * Maps an index previously saved to the specified file.  If the file is
+   * missing, or was built from data other than the specified imdb's, then
+   * good() returns false and the index shouldn't be used.
+   */
+
+  nameIndex(const imdb& db, const string& fileName);
+
+  /**
+   * Methods: good
+   *          save
+   * --------------
+   * Self-explanatory, and the same as componentTable's.
+   */
+
+  bool good() const { return header != NULL; }
+  bool save(const string& fileName) const;
+
+  /**
+   * Constant: kFileName
+   * -------------------
+   * The name the index is saved under in a data directory, where imdb-index
+   * writes it and six-degrees looks for it.
+   */
+
+  static constexpr const char *kFileName = "nameindex";
+
+  /**
+   * Methods: completeActors
+   *          completeMovies
+   * -----------------------
+   * Finds the n most popular actors (or movies) whose names (or titles) start
+   * with the specified prefix, ignoring case, most popular first.
+   *
+   * @param ids populated with the indexes of the matching records (as taken
+   *            by imdb::getActorOffset and imdb::getMovieOffset).
+   */
+
+  void completeActors(string_view prefix, int n, vector<int>& ids) const;
+  void completeMovies(string_view prefix, int n, vector<int>& ids) const;
+
+  /**
+   * Methods: suggestActors
+   *          suggestMovies
+   * ----------------------
+   * Finds the n actors (or movies) whose names (or titles) are closest to the
+   * specified one, ignoring case, within maxDistance insertions, deletions and
+   * substitutions of a single character.  Closer matches come first, and more
+   * popular ones break ties.  If maxDistance is -1, it's chosen by the length
+   * of the name: 0 for up to 2 characters, 1 for up to 5, and 2 beyond that.
+   *
+   * @param ids populated with the indexes of the matching records.
+   */
+
+  void suggestActors(string_view name, int n, vector<int>& ids, int maxDistance = -1) const;
+  void suggestMovies(string_view name, int n, vector<int>& ids, int maxDistance = -1) const;
+
+  /**
+   * Destructor: ~nameIndex
+   * ----------------------
+   * Releases the index, unmapping it if it was mapped from a file.
+   */
+
+  ~nameIndex();
+
+ private:
+  struct indexHeader {
+    int magic;
+    int numActors;
+    int numMovies;
+    int reserved;
+    long long dataSize;         // imdb::getDataSize of the data the index was built from
+  };
+
+  // one kind of record: order[i] is the record at position i of the sorted order,
+  // scores[i] its popularity, and tree the positions of the most popular records
+  // in ranges of positions, with tree[size + i] = i and tree[j] the better of
+  // tree[2j] and tree[2j + 1]
+  struct kind {
+    int size;
+    const int *order;
+    const int *scores;
+    const int *tree;
+    bool movies;
+  };
+
+  const imdb& db;
+  const indexHeader *header;
+  kind actors;
+  kind movies;
+  vector<char> built;
+  mappedFile *mapped;
+
+  void attach(const char *index);
+  static size_t indexSize(int numActors, int numMovies);
+  static void build(const imdb& db, bool movies, int *order, int *scores, int *tree);
+
+  string_view getName(const kind& k, int position) const;
+  void findPrefix(const kind& k, string_view prefix, int& lo, int& hi) const;
+  int best(const kind& k, int lo, int hi) const;
+  void complete(const kind& k, string_view prefix, int n, vector<int>& ids) const;
+  void suggest(const kind& k, string_view name, int n, vector<int>& ids, int maxDistance) const;
+  void walk(const kind& k, const string& name, int lo, int hi, int depth, int maxDistance,
+            vector<vector<int> >& rows, vector<pair<int, int> >& found) const;
+
+  // marked as private so indexes can't be copy constructed or reassigned.
+  nameIndex(const nameIndex& original);
+  nameIndex& operator=(const nameIndex& rhs);
+};
+
+#endif
@@ -0,0 +1,160 @@
+#include "packed-graph.h"
+#include "parallel-bfs.h"
+#include <cstring>
+using namespace std;
+
+static const int kGraphMagic = 0x4b435047; // "GPCK" on little-endian machines
+static const int kGraphVersion = 2;
+
+/**
+ * Varints: seven bits per byte, low bits first, high bit set on all but the last.
+ * readVarint is the decoder every search runs, so the common one-byte case is
+ * peeled off; checkedVarint is the validating decoder only the constructor runs.
+ */
+
+static void writeVarint(vector<unsigned char>& bytes, unsigned int value)
+{
+  while (value >= 0x80) {
+    bytes.push_back((value & 0x7f) | 0x80);
+    value >>= 7;
+  }
+  bytes.push_back(value);
+}
+
+static inline unsigned int readVarint(const unsigned char *& p)
+{
+  unsigned int value = *p++;
+  if (value < 0x80) return value;
+  value &= 0x7f;
+  for (int shift = 7;; shift += 7) {
+    unsigned int byte = *p++;
+    value |= (byte & 0x7f) << shift;
+    if (byte < 0x80) return value;
+  }
+}
+
+static bool checkedVarint(const unsigned char *& p, const unsigned char *end, unsigned int& value)
+{
+  value = 0;
+  for (int shift = 0; shift < 32 && p < end; shift += 7) {
+    unsigned int byte = *p++;
+    value |= (byte & 0x7f) << shift;
+    if (byte < 0x80) return true;
+  }
+  return false;
+}
+
+/**
+ * The packed lists, seen as an adjacency (see parallel-bfs.h).
+ */
+
+struct packedAdjacency {
+  const unsigned int *index;
+  const unsigned char *lists;
+  int numNodes;
+  long long numEdges;
+
+  int getNumNodes() const { return numNodes; }
+  long long getNumEdges() const { return numEdges; }
+  int getDegree(int node) const {
+    const unsigned char *p = lists + index[node];
+    return readVarint(p);
+  }
+
+  template <typename Visit>
+  void forEachNeighbour(int node, Visit visit) const {
+    const unsigned char *p = lists + index[node];
+    unsigned int count = readVarint(p), neighbour = 0;
+    for (unsigned int i = 0; i < count; i++) {
+      neighbour += readVarint(p);
+      if (visit((int) neighbour)) return;
+    }
+  }
+};
+
+bool packedGraph::write(const imdbGraph& graph, const string& fileName)
+{
+  int numActors = graph.getNumActors(), numMovies = graph.getNumMovies();
+  vector<unsigned int> index;
+  vector<unsigned char> lists;
+  for (int side = 0; side < 2; side++) {
+    int numNodes = side == 0 ? numActors : numMovies;
+    for (int node = 0; node < numNodes; node++) {
+      if (lists.size() > 0xffffffffu) return false;
+      index.push_back(lists.size());
+      int count;
+      const int *neighbours = side == 0 ? graph.getCredits(node, count) : graph.getCast(node, count);
+      writeVarint(lists, count);
+      for (int i = 0; i < count; i++)
+        writeVarint(lists, neighbours[i] - (i == 0 ? 0 : neighbours[i - 1]));
+    }
+    index.push_back(lists.size());
+  }
+  if (lists.size() > 0xffffffffu) return false;
+
+  fileHeader header = { kGraphMagic, kGraphVersion, numActors, numMovies,
+                        graph.getNumCredits(), (unsigned int) lists.size(), (long long) graph.getDataSize() };
+  vector<char> file(sizeof(header) + index.size() * sizeof(unsigned int) + lists.size());
+  char *p = file.data();
+  memcpy(p, &header, sizeof(header));
+  memcpy(p + sizeof(header), index.data(), index.size() * sizeof(unsigned int));
+  memcpy(p + sizeof(header) + index.size() * sizeof(unsigned int), lists.data(), lists.size());
+  return mappedFile::writeAtomically(fileName, file.data(), file.size());
+}
+
+packedGraph::packedGraph(const imdb& db, const string& fileName) : mapped(fileName), header(NULL)
+{
+  const fileHeader *file = (const fileHeader *) mapped.data();
+  if (file == NULL || mapped.size() < sizeof(fileHeader)) return;
+  if (file->magic != kGraphMagic || file->version != kGraphVersion ||
+      file->numActors != db.getNumActors() + db.getNumDeltaActors() ||
+      file->numMovies != db.getNumMovies() + db.getNumDeltaMovies() ||
+      file->dataSize != (long long) db.getDataSize() ||
+      file->numCredits < 0 ||
+      mapped.size() != sizeof(fileHeader) + (file->numActors + file->numMovies + 2ULL) * sizeof(unsigned int) +
+                       file->numBytes) return;
+
+  const unsigned int *fileActorIndex = (const unsigned int *) (file + 1);
+  const unsigned int *fileMovieIndex = fileActorIndex + file->numActors + 1;
+  const unsigned char *fileLists = (const unsigned char *) (fileMovieIndex + file->numMovies + 1);
+  long long actorEdges, movieEdges;
+  if (fileActorIndex[0] != 0 || fileActorIndex[file->numActors] != fileMovieIndex[0] ||
+      fileMovieIndex[file->numMovies] != file->numBytes ||
+      !validLists(fileActorIndex, file->numActors, file->numMovies, fileLists, file->numBytes, actorEdges) ||
+      !validLists(fileMovieIndex, file->numMovies, file->numActors, fileLists, file->numBytes, movieEdges) ||
+      actorEdges != file->numCredits || movieEdges != file->numCredits) return;
+
+  header = file;
+  actorIndex = fileActorIndex;
+  movieIndex = fileMovieIndex;
+  lists = fileLists;
+}
+
+bool packedGraph::validLists(const unsigned int *index, int numNodes, int numNeighbours,
+                             const unsigned char *lists, unsigned int numBytes, long long& numEdges)
+{
+  numEdges = 0;
+  for (int node = 0; node < numNodes; node++) {
+    if (index[node] > index[node + 1] || index[node + 1] > numBytes) return false;
+    const unsigned char *p = lists + index[node], *end = lists + index[node + 1];
+    unsigned int count, gap;
+    long long neighbour = 0;
+    if (!checkedVarint(p, end, count)) return false;
+    for (unsigned int i = 0; i < count; i++) {
+      if (!checkedVarint(p, end, gap) || (i > 0 && gap == 0)) return false;
+      neighbour += gap;
+      if (neighbour >= numNeighbours) return false;
+    }
+    if (p != end) return false;
+    numEdges += count;
+  }
+  return true;
+}
+
+void packedGraph::breadthFirstSearch(int source, int target, int numThreads,
+                                     vector<int>& distances, vector<imdbGraph::link>& parents) const
+{
+  parallelBreadthFirstSearch(packedAdjacency{actorIndex, lists, header->numActors, header->numCredits},
+                             packedAdjacency{movieIndex, lists, header->numMovies, header->numCredits},
+                             source, target, numThreads, distances, parents);
+}
@@ -0,0 +1,114 @@
+#ifndef __packed_graph__
+#define __packed_graph__
+
+#include "imdb-graph.h"
+#include "mapped-file.h"
+#include <string>
+#include <vector>
+using namespace std;
+
+/**
+ * Class: packedGraph
+ * ------------------
+ * A compressed, read-only copy of an imdbGraph's adjacency, mapped from a
+ * file that sits next to the data files.  Every neighbour list (the movie ids
+ * credited to an actor, or the actor ids cast in a movie) is sorted, so it's
+ * stored as its length followed by the first id and then the gaps between
+ * consecutive ids, each as a varint: seven bits per byte, low bits first, with
+ * the high bit set on every byte but the last.  Most gaps fit in one or two
+ * bytes, so the whole graph is a fraction of the size of actordata and
+ * moviedata (and about half that of the imdbGraph's own arrays), and a full
+ * traversal streams through correspondingly less memory.
+ *
+ * On disk, the file is a header, followed by the byte offset of each actor's
+ * list and then of each movie's list (plus one past the end of each), followed
+ * by the lists themselves.
+ */
+
+class packedGraph {
+
+ public:
+
+  /**
+   * Constructor: packedGraph
+   * ------------------------
+   * Maps a graph previously written to the specified file.  If the file is
+   * missing or malformed, or doesn't match the specified imdb, then good()
+   * returns false and the graph shouldn't be used.  Every list is decoded
+   * once up front to make sure it's well formed, so that searches can then
+   * decode without checking anything.
+   */
+
+  packedGraph(const imdb& db, const string& fileName);
+
+  /**
+   * Static Method: write
+   * --------------------
+   * Compresses the specified graph into the specified file, atomically.
+   *
+   * @return true if and only if the file was written.
+   */
+
+  static bool write(const imdbGraph& graph, const string& fileName);
+
+  /**
+   * Constant: kFileName
+   * -------------------
+   * The name the graph is saved under in a data directory, where imdb-pack writes it and six-degrees --packed looks for it.
+   */
+
+  static constexpr const char *kFileName = "graph";
+
+  /**
+   * Methods: good
+   *          getNumActors
+   *          getNumMovies
+   *          getNumCredits
+   *          getSize
+   * ---------------------
+   * Self-explanatory.  getSize returns the size of the file in bytes.
+   */
+
+  bool good() const { return header != NULL; }
+  int getNumActors() const { return header->numActors; }
+  int getNumMovies() const { return header->numMovies; }
+  int getNumCredits() const { return header->numCredits; }
+  size_t getSize() const { return mapped.size(); }
+
+  /**
+   * Method: breadthFirstSearch
+   * --------------------------
+   * Same as imdbGraph::breadthFirstSearch (and run by the same code), but
+   * decoding the neighbour lists on the fly.  Use imdbGraph::tracePath to
+   * turn the distances and parents into a path.
+   */
+
+  void breadthFirstSearch(int source, int target, int numThreads,
+                          vector<int>& distances, vector<imdbGraph::link>& parents) const;
+
+ private:
+  struct fileHeader {
+    int magic;
+    int version;
+    int numActors;
+    int numMovies;
+    int numCredits;
+    unsigned int numBytes;
+    long long dataSize;         // imdb::getDataSize of the data the graph was packed from
+  };
+
+  mappedFile mapped;
+  const fileHeader *header;
+  const unsigned int *actorIndex;
+  const unsigned int *movieIndex;
+  const unsigned char *lists;
+
+  static bool validLists(const unsigned int *index, int numNodes, int numNeighbours,
+                         const unsigned char *lists, unsigned int numBytes, long long& numEdges);
+
+  // marked as private so graphs can't be copy constructed or reassigned.
+  packedGraph(const packedGraph& original);
+  packedGraph& operator=(const packedGraph& rhs);
+};
+
+#endif
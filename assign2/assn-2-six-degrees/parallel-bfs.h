@@ -0,0 +1,294 @@
+#ifndef __parallel_bfs__
+#define __parallel_bfs__
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+using namespace std;
+
+/**
+ * The level-synchronous, direction-optimizing breadth-first search behind
+ * imdbGraph::breadthFirstSearch (see there for the details), written once
+ * against an abstract adjacency so that it can run over any representation
+ * of the graph.  An adjacency describes the edges out of one kind of node
+ * (actors, say) and must provide:
+ *
+ *     int getNumNodes() const;
+ *     long long getNumEdges() const;
+ *     int getDegree(int node) const;
+ *     template <typename Visit> void forEachNeighbour(int node, Visit visit) const;
+ *
+ * where visit is called with each neighbour in turn, and returns true to
+ * stop the walk early.
+ */
+
+/**
+ * Bitmaps are arrays of 64-bit words.  claimBit atomically sets a bit and
+ * reports whether this was the call that set it, so that when threads race
+ * to visit the same node during a top-down step, exactly one of them wins.
+ */
+
+typedef vector<unsigned long long> bitmap;
+
+static inline bool testBit(const bitmap& bits, int i)
+{
+  return (bits[i >> 6] >> (i & 63)) & 1;
+}
+
+static inline bool claimBit(bitmap& bits, int i)
+{
+  unsigned long long mask = 1ULL << (i & 63);
+  if (__atomic_load_n(&bits[i >> 6], __ATOMIC_RELAXED) & mask) return false;
+  return (__atomic_fetch_or(&bits[i >> 6], mask, __ATOMIC_RELAXED) & mask) == 0;
+}
+
+/**
+ * Class: workerPool
+ * -----------------
+ * Helper threads that are started once and then reused, since a search runs
+ * a parallel step per level and starting threads for every one of them would
+ * cost more than most steps do.  run(numThreads, task) calls task(t) for every
+ * t in [0, numThreads), task(0) on the calling thread and the rest on helpers
+ * (started on first use), and returns once every call has.  Each thread that
+ * runs parallel work has a pool of its own (see localWorkerPool), so
+ * concurrent searches never wait on each other's helpers, and a task may
+ * itself use a pool without deadlocking.
+ */
+
+class workerPool {
+
+ public:
+  workerPool() : task(NULL), numHelpers(0), pending(0), generation(0), stopping(false) {}
+
+  ~workerPool() {
+    {
+      lock_guard<mutex> lock(state);
+      stopping = true;
+    }
+    wake.notify_all();
+    for (thread& helper: helpers) helper.join();
+  }
+
+  void run(int numThreads, const function<void(int)>& work) {
+    while ((int) helpers.size() < numThreads - 1) {
+      int t = helpers.size() + 1;
+      helpers.push_back(thread([this, t]() { serve(t); }));
+    }
+    {
+      lock_guard<mutex> lock(state);
+      task = &work;
+      numHelpers = pending = numThreads - 1;
+      generation++;
+    }
+    wake.notify_all();
+    work(0);
+    unique_lock<mutex> lock(state);
+    done.wait(lock, [this]() { return pending == 0; });
+  }
+
+ private:
+  void serve(int t) {
+    unsigned long long served = 0;
+    while (true) {
+      const function<void(int)> *work;
+      {
+        unique_lock<mutex> lock(state);
+        wake.wait(lock, [&]() { return stopping || (generation != served && t <= numHelpers); });
+        if (stopping) return;
+        served = generation;
+        work = task;
+      }
+      (*work)(t);
+      lock_guard<mutex> lock(state);
+      if (--pending == 0) done.notify_one();
+    }
+  }
+
+  vector<thread> helpers;
+  mutex state;
+  condition_variable wake, done;
+  const function<void(int)> *task;
+  int numHelpers;
+  int pending;
+  unsigned long long generation;
+  bool stopping;
+};
+
+// inline rather than static, so that every file including this one shares the thread's pool
+inline workerPool& localWorkerPool()
+{
+  static thread_local workerPool pool;
+  return pool;
+}
+
+/**
+ * Hands [0, n) out to numThreads threads in chunks of kChunkSize, calling
+ * body(begin, end, thread) for each chunk.  Chunks are claimed dynamically,
+ * because degrees in the imdb are so skewed that equal-sized static ranges
+ * would leave most threads idle while one works through a hub.  Small
+ * amounts of work are done on the calling thread alone, and the rest on the
+ * calling thread's workerPool.
+ */
+
+static const int kChunkSize = 1024;
+
+template <typename Body>
+static void parallelFor(int numThreads, int n, Body body)
+{
+  if (numThreads <= 1 || n <= kChunkSize) {
+    body(0, n, 0);
+    return;
+  }
+  atomic<int> next(0);
+  localWorkerPool().run(numThreads, [&](int t) {
+    for (int begin = next.fetch_add(kChunkSize); begin < n; begin = next.fetch_add(kChunkSize))
+      body(begin, min(n, begin + kChunkSize), t);
+  });
+}
+
+/**
+ * The search alternates between the two sides of the graph, so each level is
+ * a step from one kind of node (say, actors) to the other (movies).  from is
+ * the adjacency out of the frontier's kind, and to the adjacency out of the
+ * next level's kind.
+ *
+ * Following Beamer et al., a step is taken bottom-up once the edges out of the
+ * frontier outnumber kAlpha-ths of the edges out of still-unvisited nodes, and
+ * top-down again once the frontier shrinks below kBeta-ths of the nodes.
+ */
+
+static const int kAlpha = 14;
+static const int kBeta = 24;
+
+template <typename Adjacency>
+struct bfsStep {
+  const Adjacency& from;
+  const Adjacency& to;
+  bitmap& visited;             // of the next level's kind
+  vector<int>& reachedThrough; // of the next level's kind
+  long long& unexploredEdges;  // out of unvisited nodes of the next level's kind
+  vector<vector<int> >& found; // per thread, scratch
+  bitmap& inFrontier;          // of the frontier's kind, scratch, all clear between steps
+};
+
+template <typename Adjacency>
+static void expandStep(bfsStep<Adjacency> step, vector<int>& frontier, bool& bottomUp, int numThreads)
+{
+  int numTo = step.to.getNumNodes();
+  long long frontierEdges = 0;
+  for (int node: frontier) frontierEdges += step.from.getDegree(node);
+  if (!bottomUp && frontierEdges > step.unexploredEdges / kAlpha) bottomUp = true;
+  else if (bottomUp && (long long) frontier.size() * kBeta < numTo) bottomUp = false;
+
+  vector<vector<int> >& found = step.found;
+  found.resize(max(1, numThreads));
+  for (vector<int>& nodes: found) nodes.clear();
+  if (!bottomUp) {
+    parallelFor(numThreads, frontier.size(), [&](int begin, int end, int t) {
+      for (int i = begin; i < end; i++) {
+        int node = frontier[i];
+        step.from.forEachNeighbour(node, [&](int neighbour) {
+          if (claimBit(step.visited, neighbour)) {
+            step.reachedThrough[neighbour] = node;
+            found[t].push_back(neighbour);
+          }
+          return false;
+        });
+      }
+    });
+  } else {
+    bitmap& inFrontier = step.inFrontier;
+    inFrontier.resize((step.from.getNumNodes() + 63) / 64, 0);
+    for (int node: frontier) inFrontier[node >> 6] |= 1ULL << (node & 63);
+    // chunks are whole 64-node words, so no two threads ever write the same visited word
+    parallelFor(numThreads, step.visited.size(), [&](int begin, int end, int t) {
+      for (int word = begin; word < end; word++) {
+        for (int node = word * 64; node < min(numTo, word * 64 + 64); node++) {
+          if (testBit(step.visited, node)) continue;
+          step.to.forEachNeighbour(node, [&](int neighbour) {
+            if (!testBit(inFrontier, neighbour)) return false;
+            step.visited[word] |= 1ULL << (node & 63);
+            step.reachedThrough[node] = neighbour;
+            found[t].push_back(node);
+            return true;
+          });
+        }
+      }
+    });
+    for (int node: frontier) inFrontier[node >> 6] = 0;
+  }
+
+  frontier.clear();
+  for (const vector<int>& nodes: found) {
+    for (int node: nodes) step.unexploredEdges -= step.to.getDegree(node);
+    frontier.insert(frontier.end(), nodes.begin(), nodes.end());
+  }
+}
+
+/**
+ * Runs the search itself, given the adjacency out of actors (credits) and out
+ * of movies (casts), populating distances and parents exactly as documented
+ * for imdbGraph::breadthFirstSearch.  Parents are pairs of ints laid out as
+ * imdbGraph::link is: the movie, then the actor.
+ *
+ * The search's own arrays are allocated once per thread and reused for every
+ * search it runs, as the bidirectional search's visitedSets are.  Only the
+ * visited bitmaps need clearing; the reachedThrough arrays are only ever read
+ * for nodes visited during the current search.
+ */
+
+struct bfsBuffers {
+  bitmap visitedActors, visitedMovies;
+  vector<int> actorReachedThrough, movieReachedThrough;
+  vector<int> frontier;
+  vector<vector<int> > found;
+  bitmap inActorFrontier, inMovieFrontier;
+};
+
+template <typename Adjacency, typename Link>
+static void parallelBreadthFirstSearch(const Adjacency& credits, const Adjacency& casts,
+                                       int source, int target, int numThreads,
+                                       vector<int>& distances, vector<Link>& parents)
+{
+  int numActors = credits.getNumNodes(), numMovies = casts.getNumNodes();
+  distances.assign(numActors, -1);
+  parents.assign(numActors, Link{-1, -1});
+  if (source < 0 || source >= numActors) return;
+
+  static thread_local bfsBuffers buffers;
+  bitmap& visitedActors = buffers.visitedActors;
+  bitmap& visitedMovies = buffers.visitedMovies;
+  visitedActors.assign((numActors + 63) / 64, 0);
+  visitedMovies.assign((numMovies + 63) / 64, 0);
+  vector<int>& actorReachedThrough = buffers.actorReachedThrough;
+  vector<int>& movieReachedThrough = buffers.movieReachedThrough;
+  actorReachedThrough.resize(numActors);
+  movieReachedThrough.resize(numMovies);
+  long long unexploredActorEdges = credits.getNumEdges(), unexploredMovieEdges = casts.getNumEdges();
+  bfsStep<Adjacency> toMovies = { credits, casts, visitedMovies, movieReachedThrough, unexploredMovieEdges,
+                                  buffers.found, buffers.inActorFrontier };
+  bfsStep<Adjacency> toActors = { casts, credits, visitedActors, actorReachedThrough, unexploredActorEdges,
+                                  buffers.found, buffers.inMovieFrontier };
+
+  claimBit(visitedActors, source);
+  unexploredActorEdges -= credits.getDegree(source);
+  distances[source] = 0;
+  vector<int>& frontier = buffers.frontier;
+  frontier.assign(1, source);
+  bool bottomUp = false;
+  for (int distance = 1; !frontier.empty() && (target == -1 || distances[target] == -1); distance++) {
+    expandStep(toMovies, frontier, bottomUp, numThreads);
+    expandStep(toActors, frontier, bottomUp, numThreads);
+    for (int actor: frontier) {
+      distances[actor] = distance;
+      parents[actor].movie = actorReachedThrough[actor];
+      parents[actor].actor = movieReachedThrough[actorReachedThrough[actor]];
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,220 @@
+#include "query-server.h"
+#include <thread>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+using namespace std;
+
+/**
+ * A worker blocks writing an answer until the client reads it, so a client
+ * that stops reading is disconnected after kSendTimeout seconds rather than
+ * tying up its worker for good.
+ */
+
+static const int kSendTimeout = 10;
+
+static bool socketAddress(const string& socketPath, sockaddr_un& address)
+{
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path)) return false;
+  memcpy(address.sun_path, socketPath.c_str(), socketPath.size());
+  return true;
+}
+
+/**
+ * Removes a socket left behind by a server that's no longer running.  Anything
+ * that isn't a socket, or a socket that some other server still answers on,
+ * is left alone, and the bind that follows fails.
+ */
+
+static void removeStaleSocket(const string& socketPath, const sockaddr_un& address)
+{
+  struct stat info;
+  if (lstat(socketPath.c_str(), &info) != 0 || !S_ISSOCK(info.st_mode)) return;
+  int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (probe == -1) return;
+  bool live = connect(probe, (const sockaddr *) &address, sizeof(address)) == 0;
+  close(probe);
+  if (!live) unlink(socketPath.c_str());
+}
+
+queryServer::queryServer(const string& socketPath, int numWorkers, handler answer)
+  : socketPath(socketPath), numWorkers(max(1, numWorkers)), answer(answer), listener(-1),
+    stopping(false), stopRequested(false), numServed(0)
+{
+  wakeup[0] = wakeup[1] = -1;
+  sockaddr_un address;
+  if (!socketAddress(socketPath, address)) return;
+  if (pipe2(wakeup, O_CLOEXEC | O_NONBLOCK) != 0) return;
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd == -1) return;
+  removeStaleSocket(socketPath, address);
+  if (bind(fd, (const sockaddr *) &address, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+    close(fd);
+    return;
+  }
+  listener = fd;
+}
+
+long long queryServer::getNumServed() const
+{
+  return numServed;
+}
+
+void queryServer::stop()
+{
+  stopRequested = true;
+  wake();
+}
+
+void queryServer::wake()
+{
+  char byte = 0;
+  ssize_t ignored = write(wakeup[1], &byte, 1); // if the pipe is full, the poller is awake anyway
+  (void) ignored;
+}
+
+void queryServer::run()
+{
+  vector<thread> workers;
+  for (int i = 0; i < numWorkers; i++) workers.push_back(thread(&queryServer::work, this));
+
+  vector<connection *> idle;
+  vector<pollfd> polled;
+  while (!stopRequested) {
+    polled.assign(2, pollfd());
+    polled[0].fd = wakeup[0];
+    polled[1].fd = listener;
+    for (connection *client: idle) polled.push_back(pollfd{client->fd, 0, 0});
+    for (pollfd& entry: polled) entry.events = POLLIN;
+    if (poll(polled.data(), polled.size(), -1) == -1) {
+      if (errno == EINTR) continue;
+      break;
+    }
+
+    if (polled[0].revents != 0) {
+      char bytes[64];
+      while (read(wakeup[0], bytes, sizeof(bytes)) > 0) ;
+      lock_guard<mutex> guard(lock);
+      idle.insert(idle.end(), returned.begin(), returned.end());
+      returned.clear();
+    }
+
+    // idle only grows past the end of what was polled, so the entries still line up
+    vector<connection *> stillIdle;
+    bool handedOut = false;
+    for (size_t i = 2; i < polled.size(); i++) {
+      if (polled[i].revents == 0) {
+        stillIdle.push_back(idle[i - 2]);
+      } else {
+        lock_guard<mutex> guard(lock);
+        ready.push_back(idle[i - 2]);
+        handedOut = true;
+      }
+    }
+    stillIdle.insert(stillIdle.end(), idle.begin() + (polled.size() - 2), idle.end());
+    idle.swap(stillIdle);
+    if (handedOut) readyChanged.notify_all();
+
+    if (polled[1].revents & POLLIN) {
+      int fd = accept4(listener, NULL, NULL, SOCK_CLOEXEC);
+      if (fd != -1) {
+        timeval timeout = { kSendTimeout, 0 };
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        idle.push_back(new connection{fd, ""});
+      }
+    }
+  }
+
+  {
+    lock_guard<mutex> guard(lock);
+    stopping = true;
+  }
+  readyChanged.notify_all();
+  for (thread& worker: workers) worker.join();
+  idle.insert(idle.end(), returned.begin(), returned.end());
+  returned.clear();
+  for (connection *client: idle) {
+    close(client->fd);
+    delete client;
+  }
+}
+
+void queryServer::work()
+{
+  while (true) {
+    connection *client;
+    {
+      unique_lock<mutex> guard(lock);
+      readyChanged.wait(guard, [this]() { return stopping || !ready.empty(); });
+      if (ready.empty()) return;
+      client = ready.front();
+      ready.pop_front();
+    }
+    if (!serve(client)) {
+      close(client->fd);
+      delete client;
+      continue;
+    }
+    {
+      lock_guard<mutex> guard(lock);
+      returned.push_back(client);
+    }
+    wake();
+  }
+}
+
+/**
+ * Reads whatever the client has sent and answers every complete request in
+ * it, returning false once the connection should be closed: the client hung
+ * up, a write failed, or a request is implausibly long.
+ */
+
+bool queryServer::serve(connection *client)
+{
+  char bytes[4096];
+  ssize_t numRead;
+  do numRead = read(client->fd, bytes, sizeof(bytes)); while (numRead == -1 && errno == EINTR);
+  if (numRead <= 0) return false;
+  client->pending.append(bytes, numRead);
+
+  size_t start = 0, end;
+  string replies;
+  while ((end = client->pending.find('\n', start)) != string::npos) {
+    size_t length = end - start;
+    if (length > 0 && client->pending[end - 1] == '\r') length--;
+    replies += answer(client->pending.substr(start, length));
+    numServed++;
+    start = end + 1;
+  }
+  client->pending.erase(0, start);
+  if (client->pending.size() > kMaxRequestLength) return false;
+
+  for (size_t written = 0; written < replies.size();) {
+    ssize_t numWritten = send(client->fd, replies.data() + written, replies.size() - written, MSG_NOSIGNAL);
+    if (numWritten == -1 && errno == EINTR) continue;
+    if (numWritten <= 0) return false;
+    written += numWritten;
+  }
+  return true;
+}
+
+queryServer::~queryServer()
+{
+  if (listener != -1) {
+    close(listener);
+    unlink(socketPath.c_str());
+  }
+  if (wakeup[0] != -1) close(wakeup[0]);
+  if (wakeup[1] != -1) close(wakeup[1]);
+  for (connection *client: ready) {
+    close(client->fd);
+    delete client;
+  }
+}
@@ -0,0 +1,119 @@
+#ifndef __query_server__
+#define __query_server__
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+using namespace std;
+
+/**
+ * Class: queryServer
+ * ------------------
+ * Answers queries sent over a Unix domain socket, one request per line, so
+ * that a process that already has everything mapped, compiled and warmed
+ * can serve any number of short-lived clients.  The answer to each request
+ * is whatever the handler returns, which is written back in full before the
+ * next request on the same connection is answered, so clients can pipeline.
+ *
+ * One thread polls the listening socket and every idle connection.  When a
+ * connection has something to read, it's handed to one of a pool of worker
+ * threads, which reads whatever has arrived, answers every complete line in
+ * order, and hands the connection back.  Idle clients therefore cost nothing
+ * but a file descriptor, and a pool of n workers answers up to n clients at
+ * a time, however many are connected.
+ */
+
+class queryServer {
+
+ public:
+
+  typedef function<string(const string& request)> handler;
+
+  /**
+   * Constructor: queryServer
+   * ------------------------
+   * Binds and listens on the specified socket path, replacing any stale
+   * socket already there (but never any other kind of file).  If that fails,
+   * good() returns false and the server shouldn't be run.
+   *
+   * @param socketPath the path the socket should be bound to.
+   * @param numWorkers the number of threads answering requests.
+   * @param answer the function that answers each request, which is called
+   *               from the worker threads concurrently.  The request is
+   *               passed without its trailing newline (or carriage return).
+   */
+
+  queryServer(const string& socketPath, int numWorkers, handler answer);
+
+  /**
+   * Methods: good
+   *          getNumServed
+   * ------------------------
+   * Self-explanatory.  getNumServed returns the number of requests answered.
+   */
+
+  bool good() const { return listener != -1; }
+  long long getNumServed() const;
+
+  /**
+   * Method: run
+   * -----------
+   * Serves requests until stop is called, and then waits for the workers
+   * to finish whatever they're answering before returning.
+   */
+
+  void run();
+
+  /**
+   * Method: stop
+   * ------------
+   * Asks run to return.  stop only writes a byte to a pipe, so it's safe
+   * to call from any thread, and from a signal handler.
+   */
+
+  void stop();
+
+  /**
+   * Destructor: ~queryServer
+   * ------------------------
+   * Closes every connection and removes the socket.
+   */
+
+  ~queryServer();
+
+ private:
+  struct connection {
+    int fd;
+    string pending;            // bytes received that don't yet make up a whole line
+  };
+
+  static const size_t kMaxRequestLength = 1 << 16;
+
+  string socketPath;
+  int numWorkers;
+  handler answer;
+  int listener;
+  int wakeup[2];               // written to whenever the polling thread should look up
+
+  mutex lock;
+  condition_variable readyChanged;
+  deque<connection *> ready;   // connections with something to read, waiting for a worker
+  vector<connection *> returned; // connections the workers are done with for now
+  bool stopping;               // tells the workers to finish up
+  atomic<bool> stopRequested;  // set by stop, which can't take the lock
+  atomic<long long> numServed;
+
+  void work();
+  bool serve(connection *client);
+  void wake();
+
+  // marked as private so servers can't be copy constructed or reassigned.
+  queryServer(const queryServer& original);
+  queryServer& operator=(const queryServer& rhs);
+};
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef __search_filter__
+#define __search_filter__
+
+#include "imdb-graph.h"
+#include <climits>
+#include <vector>
+using namespace std;
+
+/**
+ * Class: searchFilter
+ * -------------------
+ * Restricts the paths imdbGraph::findShortestPath may take to movies released
+ * within a window of years, and to movies and actors that haven't been
+ * excluded outright.  Every check is a lookup by id: movie years come from the
+ * graph's dense array of year bytes (see imdbGraph::getMovieYearByte), and the
+ * exclusions are bitmaps, so filtering costs the search a few instructions per
+ * edge and never decodes a title or a name.
+ *
+ * A filter is built once and may then be shared by any number of concurrent
+ * searches.
+ */
+
+class searchFilter {
+
+ public:
+
+  /**
+   * Constructor: searchFilter
+   * -------------------------
+   * Creates a filter over the specified graph that lets everything through.
+   * The graph must outlive the filter.
+   */
+
+  searchFilter(const imdbGraph& graph) :
+    years(graph.getMovieYearBytes()), firstYearByte(CHAR_MIN), lastYearByte(CHAR_MAX),
+    excludedMovies((graph.getNumMovies() + 63) / 64, 0),
+    excludedActors((graph.getNumActors() + 63) / 64, 0) {}
+
+  /**
+   * Method: setYears
+   * ----------------
+   * Only lets through movies released from firstYear to lastYear inclusive.
+   * Year bytes are chars, as film years are decoded from them, so the years
+   * that can be told apart are the ones a char less 1900 can hold.
+   */
+
+  void setYears(int firstYear, int lastYear) {
+    firstYearByte = max(CHAR_MIN, min(CHAR_MAX + 1, firstYear - 1900));
+    lastYearByte = max(CHAR_MIN - 1, min(CHAR_MAX, lastYear - 1900));
+  }
+
+  /**
+   * Methods: excludeMovie
+   *          excludeActor
+   * ---------------------
+   * Keeps the movie or actor with the specified id off every path.
+   */
+
+  void excludeMovie(int movie) { excludedMovies[movie >> 6] |= 1ULL << (movie & 63); }
+  void excludeActor(int actor) { excludedActors[actor >> 6] |= 1ULL << (actor & 63); }
+
+  /**
+   * Methods: allowsMovie
+   *          allowsActor
+   * --------------------
+   * Self-explanatory.
+   */
+
+  bool allowsMovie(int movie) const {
+    int yearByte = years[movie];
+    return yearByte >= firstYearByte && yearByte <= lastYearByte &&
+           ((excludedMovies[movie >> 6] >> (movie & 63)) & 1) == 0;
+  }
+
+  bool allowsActor(int actor) const {
+    return ((excludedActors[actor >> 6] >> (actor & 63)) & 1) == 0;
+  }
+
+ private:
+  const char *years;
+  int firstYearByte;
+  int lastYearByte;
+  vector<unsigned long long> excludedMovies;
+  vector<unsigned long long> excludedActors;
+};
+
+#endif
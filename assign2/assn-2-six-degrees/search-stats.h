@@ -0,0 +1,112 @@
+#ifndef __search_stats__
+#define __search_stats__
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+using namespace std;
+
+/**
+ * Struct: searchStats
+ * -------------------
+ * Counts what answering path queries cost, for when a query is slower than it
+ * ought to be.  Every search that takes a searchStats (each takes a pointer
+ * that may be NULL, in which case nothing is counted) adds to it, so a single
+ * searchStats can cover one query, or a whole batch of them via add.
+ *
+ *     lookups, probes, comparisons   names and titles looked up, the slots,
+ *                                    tree nodes or table entries probed while
+ *                                    looking them up, and the full string
+ *                                    comparisons those probes came to.
+ *     actorsExpanded, moviesExpanded actors whose credits, and movies whose
+ *                                    casts, a search walked.
+ *     frontierSizes                  the number of actors expanded at each step
+ *                                    of a search (summed step by step across
+ *                                    the queries added together).
+ *     bytesTouched                   bytes of the memory-mapped records read:
+ *                                    the names compared by lookups, the records
+ *                                    a search of the imdb itself decodes, and
+ *                                    the records decoded for the final path.
+ *                                    Searches of the graph read none, since the
+ *                                    graph lives on the heap.
+ *     lookupMicros, expansionMicros, reconstructionMicros
+ *                                    wall time spent resolving the two names,
+ *                                    searching, and decoding the path found.
+ *
+ * The parallel search and the centre's table only report their time, all of
+ * it as expansion, since they don't search one level at a time.
+ */
+
+struct searchStats {
+  long long queries = 0;
+  long long lookups = 0;
+  long long probes = 0;
+  long long comparisons = 0;
+  long long actorsExpanded = 0;
+  long long moviesExpanded = 0;
+  long long bytesTouched = 0;
+  vector<long long> frontierSizes;
+  double lookupMicros = 0;
+  double expansionMicros = 0;
+  double reconstructionMicros = 0;
+
+  /**
+   * Method: add
+   * -----------
+   * Adds the other stats into these ones.
+   */
+
+  void add(const searchStats& other) {
+    queries += other.queries;
+    lookups += other.lookups;
+    probes += other.probes;
+    comparisons += other.comparisons;
+    actorsExpanded += other.actorsExpanded;
+    moviesExpanded += other.moviesExpanded;
+    bytesTouched += other.bytesTouched;
+    if (frontierSizes.size() < other.frontierSizes.size()) frontierSizes.resize(other.frontierSizes.size(), 0);
+    for (size_t i = 0; i < other.frontierSizes.size(); i++) frontierSizes[i] += other.frontierSizes[i];
+    lookupMicros += other.lookupMicros;
+    expansionMicros += other.expansionMicros;
+    reconstructionMicros += other.reconstructionMicros;
+  }
+
+  /**
+   * Static Method: lap
+   * ------------------
+   * Returns the microseconds since the specified time, and resets it to now,
+   * so that consecutive phases can be timed with one time point.
+   */
+
+  static double lap(chrono::steady_clock::time_point& since) {
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    double micros = chrono::duration<double, micro>(now - since).count();
+    since = now;
+    return micros;
+  }
+};
+
+/**
+ * Publishes the stats on a single line, with the frontier sizes in square
+ * brackets, one per step.
+ */
+
+inline ostream& operator<<(ostream& os, const searchStats& stats)
+{
+  os << stats.lookups << " lookups (" << stats.probes << " probes, " << stats.comparisons
+     << " string comparisons), " << stats.actorsExpanded << " actors and " << stats.moviesExpanded
+     << " movies expanded, frontiers [";
+  for (size_t i = 0; i < stats.frontierSizes.size(); i++) os << (i == 0 ? "" : " ") << stats.frontierSizes[i];
+  ios_base::fmtflags flags = os.flags();
+  streamsize precision = os.precision();
+  os << "], " << stats.bytesTouched << " bytes touched; " << fixed << setprecision(1)
+     << "lookup " << stats.lookupMicros << ", expansion " << stats.expansionMicros
+     << ", reconstruction " << stats.reconstructionMicros << " microseconds";
+  os.flags(flags);
+  os.precision(precision);
+  return os;
+}
+
+#endif
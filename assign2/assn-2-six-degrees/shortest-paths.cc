@@ -0,0 +1,116 @@
+#include "shortest-paths.h"
+#include "search-filter.h"
+using namespace std;
+
+shortestPaths::shortestPaths(const imdbGraph& graph, int source, int target, const searchFilter *filter) :
+  distance(-1), numPaths(0), started(false)
+{
+  if (filter != NULL && (!filter->allowsActor(source) || !filter->allowsActor(target))) return;
+
+  // label every actor up to the target's layer with its distance from the source
+  vector<int> actorDistance(graph.getNumActors(), -1);
+  vector<bool> movieSeen(graph.getNumMovies(), false);
+  actorDistance[source] = 0;
+  vector<int> frontier(1, source), next;
+  for (int depth = 1; actorDistance[target] == -1 && !frontier.empty(); depth++) {
+    next.clear();
+    for (int player: frontier) {
+      int numCredits;
+      const int *credits = graph.getCredits(player, numCredits);
+      for (int i = 0; i < numCredits; i++) {
+        int movie = credits[i];
+        if (movieSeen[movie]) continue;
+        movieSeen[movie] = true;
+        if (filter != NULL && !filter->allowsMovie(movie)) continue;
+        int numCast;
+        const int *cast = graph.getCast(movie, numCast);
+        for (int j = 0; j < numCast; j++) {
+          int costar = cast[j];
+          if (actorDistance[costar] != -1 || (filter != NULL && !filter->allowsActor(costar))) continue;
+          actorDistance[costar] = depth;
+          next.push_back(costar);
+        }
+      }
+    }
+    frontier.swap(next);
+  }
+  if (actorDistance[target] == -1) return;
+  distance = actorDistance[target];
+
+  // sweep back from the target, one layer at a time, so nodes are numbered by
+  // decreasing distance and every leg leads to a node numbered after its own
+  unordered_map<int, int> nodeOf;
+  nodeOf[target] = 0;
+  actors.push_back(target);
+  legStart.push_back(0);
+  for (size_t node = 0; node < actors.size(); node++) {
+    int player = actors[node];
+    int previous = actorDistance[player] - 1;
+    int numCredits;
+    const int *credits = graph.getCredits(player, numCredits);
+    for (int i = 0; previous >= 0 && i < numCredits; i++) {
+      int movie = credits[i];
+      if (filter != NULL && !filter->allowsMovie(movie)) continue;
+      int numCast;
+      const int *cast = graph.getCast(movie, numCast);
+      for (int j = 0; j < numCast; j++) {
+        if (actorDistance[cast[j]] != previous) continue;
+        unordered_map<int, int>::const_iterator found = nodeOf.find(cast[j]);
+        if (found == nodeOf.end()) {
+          found = nodeOf.insert(make_pair(cast[j], actors.size())).first;
+          actors.push_back(cast[j]);
+        }
+        legMovies.push_back(movie);
+        legFrom.push_back(found->second);
+      }
+    }
+    legStart.push_back(legMovies.size());
+  }
+
+  // the source is the last node, and the only one without legs
+  vector<double> paths(actors.size(), 0);
+  for (int node = actors.size() - 1; node >= 0; node--) {
+    if (legStart[node] == legStart[node + 1]) paths[node] = 1;
+    for (int leg = legStart[node]; leg < legStart[node + 1]; leg++) paths[node] += paths[legFrom[leg]];
+  }
+  numPaths = paths[0];
+  chosen.resize(distance);
+}
+
+/**
+ * Takes the first leg out of every node from the specified depth back to the source.
+ */
+
+void shortestPaths::descend(int depth, int node)
+{
+  for (; depth < distance; depth++) {
+    chosen[depth] = legStart[node];
+    node = legFrom[chosen[depth]];
+  }
+}
+
+bool shortestPaths::next(vector<imdbGraph::link>& links)
+{
+  if (distance == -1) return false;
+  if (!started) {
+    started = true;
+    descend(0, 0);
+  } else {
+    // advance the leg nearest the source that has any alternatives left
+    int depth = distance - 1;
+    for (; depth >= 0; depth--) {
+      int node = depth == 0 ? 0 : legFrom[chosen[depth - 1]];
+      if (chosen[depth] + 1 < legStart[node + 1]) break;
+    }
+    if (depth < 0) return false;
+    chosen[depth]++;
+    descend(depth + 1, legFrom[chosen[depth]]);
+  }
+
+  links.clear();
+  for (int depth = distance - 1; depth >= 0; depth--) {
+    int node = depth == 0 ? 0 : legFrom[chosen[depth - 1]];
+    links.push_back({legMovies[chosen[depth]], actors[node]});
+  }
+  return true;
+}
@@ -0,0 +1,88 @@
+#ifndef __shortest_paths__
+#define __shortest_paths__
+
+#include "imdb-graph.h"
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+class searchFilter;
+
+/**
+ * Class: shortestPaths
+ * --------------------
+ * Every shortest path between two actors, counted up front and then handed
+ * out one at a time.  There can be astronomically many of them, so they're
+ * never materialised.  Instead, a breadth-first search out of the source
+ * labels every actor with its distance, and a sweep back from the target
+ * keeps just the actors that lie on some shortest path, each with the legs
+ * (a movie and an actor one movie closer to the source) that lead into it.
+ * That layered DAG is small, every walk back through it from the target ends
+ * at the source, and so the paths are exactly those walks: they're counted
+ * by summing over the DAG, and enumerated by a depth-first walk whose only
+ * state is the leg chosen at each layer.
+ *
+ * Two paths count as different if they differ in any actor or any movie, so
+ * two actors who've made several movies together are connected several times.
+ */
+
+class shortestPaths {
+
+ public:
+
+  /**
+   * Constructor: shortestPaths
+   * --------------------------
+   * Searches the graph and builds the DAG of every shortest path from source
+   * to target that the filter allows (or of every shortest path, if the
+   * filter is NULL).
+   */
+
+  shortestPaths(const imdbGraph& graph, int source, int target, const searchFilter *filter = NULL);
+
+  /**
+   * Methods: getDistance
+   *          getNumPaths
+   * --------------------
+   * getDistance returns the number of movies on every shortest path, or -1
+   * if there's no path at all, and getNumPaths the number of shortest paths,
+   * as a double since it can exceed any integer type.
+   */
+
+  int getDistance() const { return distance; }
+  double getNumPaths() const { return numPaths; }
+
+  /**
+   * Method: next
+   * ------------
+   * Produces the legs of the next shortest path (see imdbGraph::decodePath).
+   * Paths come out in a fixed order, and each exactly once.
+   *
+   * @return true if there was another path, and false once they've all been produced.
+   */
+
+  bool next(vector<imdbGraph::link>& links);
+
+ private:
+  int distance;
+  double numPaths;
+
+  // the DAG: node i is the actor actors[i], and the legs into it are
+  // (legMovies[j], legFrom[j]) for j from legStart[i] up to legStart[i + 1]
+  vector<int> actors;
+  vector<int> legStart;
+  vector<int> legMovies;
+  vector<int> legFrom;
+
+  // the walk: chosen[d] is the leg taken into the node d movies back from the target
+  vector<int> chosen;
+  bool started;
+
+  void descend(int depth, int node);
+
+  // marked as private so enumerations can't be copy constructed or reassigned.
+  shortestPaths(const shortestPaths& original);
+  shortestPaths& operator=(const shortestPaths& rhs);
+};
+
+#endif
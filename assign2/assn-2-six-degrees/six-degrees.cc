@@ -1,11 +1,36 @@
 #include <vector>
-#include <queue>
-#include <unordered_set>
-#include <set>
+#include <unordered_map>
 #include <string>
 #include <iostream>
 #include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cctype>
+#include <thread>
+#include <cerrno>
+#include <climits>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
 #include "imdb.h"
+#include "imdb-graph.h"
+#include "packed-graph.h"
+#include "bacon-table.h"
+#include "landmark-table.h"
+#include "component-table.h"
+#include "search-filter.h"
+#include "shortest-paths.h"
+#include "k-shortest-paths.h"
+#include "name-index.h"
+#include "search-stats.h"
+#include "visited-set.h"
+#include "query-server.h"
+#include "lru-cache.h"
 #include "path.h"
 using namespace std;
 
@@ -16,163 +41,1301 @@ using namespace std;
  * the referenced imdb existsif (or if the user just hits return,
  * which is a signal that the empty string should just be returned.)
  *
+ * With a name index, a response ending in * lists the most prolific
+ * actors whose names start with the rest of it, and a name that isn't
+ * in the database is answered with the closest names that are.
+ *
  * @param prompt the text that should be used for the meaningful
  *               part of the user prompt.
  * @param db a reference to the imdb which can be used to confirm
  *           that a user's response is a legitimate one.
+ * @param names the name index used to complete and correct names, or NULL.
  * @return the name of the user-supplied actor or actress, or the
  *         empty string.
  */
 
-static string promptForActor(const string& prompt, const imdb& db)
+static const int kNumSuggestions = 10;
+
+static string promptForActor(const string& prompt, const imdb& db, const nameIndex *names)
 {
   string response;
   while (true) {
     cout << prompt << " [or <enter> to quit]: ";
     getline(cin, response);
     if (response == "") return "";
-    vector<film> credits;
-    if (db.getCredits(response, credits)) return response;
-    cout << "We couldn't find \"" << response << "\" in the movie database. "
-	 << "Please try again." << endl;
+    vector<int> ids;
+    if (names != NULL && response.back() == '*') {
+      names->completeActors(string_view(response).substr(0, response.size() - 1), kNumSuggestions, ids);
+      if (ids.empty()) cout << "No one's name starts with \"" << response.substr(0, response.size() - 1) << "\"." << endl;
+      for (int id: ids) cout << "\t" << db.getActor(db.getActorOffset(id)).name << endl;
+      continue;
+    }
+    if (db.findActor(response) != -1) return response;
+    cout << "We couldn't find \"" << response << "\" in the movie database. ";
+    if (names != NULL) names->suggestActors(response, kNumSuggestions, ids);
+    if (ids.empty()) {
+      cout << "Please try again." << endl;
+      continue;
+    }
+    cout << "Did you mean one of these?" << endl;
+    for (int id: ids) cout << "\t" << db.getActor(db.getActorOffset(id)).name << endl;
+  }
+}
+
+/**
+ * Searches never copy paths (or even names) around.  Instead, every actor reached
+ * maps, by the offset of its record, to the offsets of the movie and the actor it
+ * was first reached through, and the path is decoded from that chain only once
+ * the search succeeds.  The origin of a search maps to a pair of -1s.
+ */
+
+struct predecessor {
+  int movie;
+  int player;
+};
+
+typedef unordered_map<int, predecessor> predecessorMap;
+
+/**
+ * Rebuilds the path from the origin of a search out to the specified
+ * actor by walking the chain of predecessors back from that actor.
+ * The bytes of the records decoded are counted into stats, unless
+ * it's NULL.
+ */
+
+static path rebuildPath(const predecessorMap& visitedActors, int player, const imdb& db,
+                        searchStats *stats = NULL)
+{
+  vector<int> players;
+  while (visitedActors.at(player).player != -1) {
+    players.push_back(player);
+    player = visitedActors.at(player).player;
+  }
+
+  path result(string(db.getActor(player).name));
+  if (stats != NULL) stats->bytesTouched += db.getActor(player).getSize();
+  for (int i = players.size() - 1; i >= 0; i--) {
+    imdb::movieRecord movie = db.getMovie(visitedActors.at(players[i]).movie);
+    imdb::actorRecord actor = db.getActor(players[i]);
+    result.addConnection(movie.getFilm(), string(actor.name));
+    if (stats != NULL) stats->bytesTouched += movie.getSize() + actor.getSize();
+  }
+  return result;
+}
+
+/**
+ * Co-star cache
+ * -------------
+ * Expanding an actor means decoding the actor's record and then the record of
+ * every movie in it, which for the hubs most searches pass through is hundreds
+ * of records scattered across moviedata.  When a co-star cache is supplied,
+ * the (movie, co-star) pairs of every actor with at least kMinCachedCredits
+ * credits are decoded once into a costarList, by record offset, and later
+ * expansions of that actor read them from there.  Actors with fewer credits
+ * are cheap enough to decode every time, and would only churn the cache.
+ */
+
+struct costarList {
+  vector<int> movies;
+  vector<int> castStart;       // movie i's cast is cast[castStart[i]] up to cast[castStart[i + 1]]
+  vector<int> cast;
+};
+
+typedef lruCache<int, shared_ptr<const costarList> > costarCache;
+
+static const int kMinCachedCredits = 16;
+
+static shared_ptr<const costarList> getCostars(const imdb::actorRecord& actor, const imdb& db, costarCache& cache)
+{
+  shared_ptr<const costarList> cached;
+  if (cache.get(actor.offset, cached)) return cached;
+  shared_ptr<costarList> costars = make_shared<costarList>();
+  costars->movies.assign(actor.credits, actor.credits + actor.numCredits);
+  costars->castStart.push_back(0);
+  for (int i = 0; i < actor.numCredits; i++) {
+    imdb::movieRecord movie = db.getMovie(actor.credits[i]);
+    costars->cast.insert(costars->cast.end(), movie.cast, movie.cast + movie.numActors);
+    costars->castStart.push_back(costars->cast.size());
+  }
+  cache.put(actor.offset, costars, sizeof(costarList) + 64 +
+            (costars->movies.size() + costars->castStart.size() + costars->cast.size()) * sizeof(int));
+  return costars;
+}
+
+/**
+ * Bookkeeping for one side of the bidirectional search.  visitedActors holds
+ * the predecessors of every actor reached from this side, and frontier holds
+ * the actors discovered during the most recent level.  Whether an actor or
+ * movie has been reached at all is tracked separately, by record offset, in
+ * actorSeen and movieSeen, since those checks vastly outnumber the actors
+ * actually reached.  Every record is a whole number of words long, so its
+ * offset divided by four is a unique bit number.
+ *
+ * The two sets are allocated once per thread and reused for every query it
+ * answers (see visitedSet), and sized by the number of words in each file,
+ * since the records needn't be laid out in the order of the offset table.
+ */
+
+struct searchSide {
+  predecessorMap visitedActors;
+  visitedSet& actorSeen;
+  visitedSet& movieSeen;
+  vector<int> frontier;
+
+  searchSide(int origin, visitedSet& actorSeen, visitedSet& movieSeen, const imdb& db) :
+    actorSeen(actorSeen), movieSeen(movieSeen) {
+    actorSeen.reset((db.getActorDataSize() + 3) / 4);
+    movieSeen.reset((db.getMovieDataSize() + 3) / 4);
+    visitedActors.insert({origin, {-1, -1}});
+    actorSeen.insert(origin / 4);
+    frontier.push_back(origin);
   }
+};
+
+/**
+ * Builds the full path once the two sides have met at the specified actor:
+ * the forward side's chain is rebuilt out to the meeting point, and then the
+ * backward side's predecessors are followed out to the target.
+ */
+
+static path joinPaths(int meeting, const searchSide& forward, const searchSide& backward, const imdb& db,
+                      searchStats *stats)
+{
+  path result = rebuildPath(forward.visitedActors, meeting, db, stats);
+  for (predecessor pred = backward.visitedActors.at(meeting); pred.player != -1;
+       pred = backward.visitedActors.at(pred.player)) {
+    imdb::movieRecord movie = db.getMovie(pred.movie);
+    imdb::actorRecord actor = db.getActor(pred.player);
+    result.addConnection(movie.getFilm(), string(actor.name));
+    if (stats != NULL) stats->bytesTouched += movie.getSize() + actor.getSize();
+  }
+  return result;
+}
+
+/**
+ * Expands every actor in the side's frontier by one level (actor -> movie -> actor),
+ * replacing the frontier with the newly discovered actors.  Returns as soon as
+ * a discovered actor has already been reached by the other side, since with
+ * whole levels expanded at a time the first meeting point lies on a shortest path.
+ *
+ * @param costars the cache of hubs' co-stars, or NULL to decode every actor.
+ * @param stats counts the actors and movies expanded, the frontier, and the
+ *              bytes of the records decoded (but not of the cached co-stars),
+ *              unless it's NULL.
+ * @param meeting set to the actor where the two sides met, if they did.
+ * @return true if and only if the two sides met.
+ */
+
+static bool expandLevel(searchSide& side, const searchSide& other, const imdb& db,
+                        costarCache *costars, searchStats *stats, int& meeting)
+{
+  vector<int> next;
+  if (stats != NULL) {
+    stats->actorsExpanded += side.frontier.size();
+    stats->frontierSizes.push_back(side.frontier.size());
+  }
+  auto reach = [&](int costar, int movie, int player) {
+    if (!side.actorSeen.insert(costar / 4)) return false;
+    side.visitedActors.insert({costar, {movie, player}});
+    if (!other.actorSeen.contains(costar / 4)) {
+      next.push_back(costar);
+      return false;
+    }
+    meeting = costar;
+    return true;
+  };
+
+  for (int player: side.frontier) {
+    imdb::actorRecord actor = db.getActor(player);
+    if (costars != NULL && actor.numCredits >= kMinCachedCredits) {
+      shared_ptr<const costarList> list = getCostars(actor, db, *costars);
+      for (size_t i = 0; i < list->movies.size(); i++) {
+        if (!side.movieSeen.insert(list->movies[i] / 4)) continue;
+        if (stats != NULL) stats->moviesExpanded++;
+        for (int j = list->castStart[i]; j < list->castStart[i + 1]; j++)
+          if (reach(list->cast[j], list->movies[i], player)) return true;
+      }
+      continue;
+    }
+    if (stats != NULL) stats->bytesTouched += actor.getSize();
+    for (int i = 0; i < actor.numCredits; i++) {
+      if (!side.movieSeen.insert(actor.credits[i] / 4)) continue;
+      imdb::movieRecord movie = db.getMovie(actor.credits[i]);
+      if (stats != NULL) {
+        stats->moviesExpanded++;
+        stats->bytesTouched += movie.getSize();
+      }
+      for (int j = 0; j < movie.numActors; j++)
+        if (reach(movie.cast[j], movie.offset, player)) return true;
+    }
+  }
+  side.frontier.swap(next);
+  return false;
 }
 
 /**
- * @brief Generate Shortest Path from one Actor to Another
+ * @brief Bidirectional breadth-first search from both actors at once
+ * Each round expands one full level of whichever side currently has the
+ * smaller frontier, and the search stops as soon as the two sides meet.
+ * Only reads the imdb, so any number of searches may run concurrently.
+ *
  * @param source: First actor
  * @param target: Actor we want to find
- * @param db a reference to the imdb which can be used to confirm
- *           that a user's response is a legitimate one.
- * @param doReverse: will be a bool to tell whether to call reverse before printing
- */
-
-bool generateShortestPathV1 (string source, string target, const imdb& db, bool doReverse) {
-  // Modified imdb, without any major changes for this little optimisation
-  // ideally you want to have another function and not have to use a same function signature
-  // but Lazy me
-  vector<film> dummy;
-  short nSource = 0;
-  short nTarget = 0;
-  db.getCredits(source, dummy, &nSource, true);
-  vector<film> targetFilms;
-  db.getCredits(target, dummy, &nTarget, true);
-  if (nSource > nTarget) {
-    return generateShortestPathV1(target, source, db, true);
-  }
-
-  unordered_set<string> visitedActors;
-  set<film> visitedMovies;
-  queue<path> branches;
-  branches.push(path(source));
-
-  while (!branches.empty()) {
-    path branch = branches.front();
-    branches.pop();
-
-    // we get movies of node and process them
-    vector<film> credits;
-    db.getCredits( branch.getLastPlayer(), credits);
-
-    for (film& movie: credits) {
-      if (visitedMovies.insert(movie).second) {
-        // If film f is being processed for the first time
-        vector<string> cast;
-        db.getCast(movie, cast);
-
-        for (string& actor: cast) {
-          if (visitedActors.insert(actor).second) {
-            branch.addConnection(movie, actor);
-            if (actor == target) {
-              if (doReverse) {
-                branch.reverse();
-              }
-              cout << "\n" << branch << "\n";
-              return true;
-            }
-            else {
-              branches.push(branch);
-            }
-            branch.undoConnection();
-          }
-        }
-      }
+ * @param db a reference to the imdb housing both actors.
+ * @param costars the cache of hubs' co-stars, or NULL.
+ * @param result set to the path from source to target, if one exists.
+ * @param stats the statistics the search adds to, or NULL (see searchStats).
+ * @return true if and only if a path was found.
+ */
+
+static bool generateShortestPath (const string& source, const string& target, const imdb& db,
+                                  costarCache *costars, path& result, searchStats *stats) {
+  static thread_local visitedSet seen[4];
+  chrono::steady_clock::time_point phase = chrono::steady_clock::now();
+  searchSide sourceSide(db.getActorOffset(db.findActor(source)), seen[0], seen[1], db);
+  searchSide targetSide(db.getActorOffset(db.findActor(target)), seen[2], seen[3], db);
+  int meeting;
+
+  while (!sourceSide.frontier.empty() && !targetSide.frontier.empty()) {
+    if (sourceSide.frontier.size() <= targetSide.frontier.size()) {
+      if (!expandLevel(sourceSide, targetSide, db, costars, stats, meeting)) continue;
+    } else {
+      if (!expandLevel(targetSide, sourceSide, db, costars, stats, meeting)) continue;
     }
+    if (stats != NULL) stats->expansionMicros += searchStats::lap(phase);
+    result = joinPaths(meeting, sourceSide, targetSide, db, stats);
+    if (stats != NULL) stats->reconstructionMicros += searchStats::lap(phase);
+    return true;
   }
+  if (stats != NULL) stats->expansionMicros += searchStats::lap(phase);
   return false;
 }
 
 /**
-bool generateShortestPath (string source, string target, const imdb& db) {
-  set<film> sourceVisitedMovies, targetVisitedMovies;
-  unordered_set<string> sourceVisitedActors, targetVisitedActors;
-  queue<path> sourceBranches, targetBranches;
-  sourceBranches.push(path(source));
-  targetBranches.push(path(target));
-
-  while (!sourceBranches.empty() && !targetBranches.empty()) {
-    int n = sourceBranches.size();
-    for (int i = 0; i < n; i++) {
-      path sourceBranch = sourceBranches.front();
-      sourceBranches.pop();
-      vector<film> credits;
-      db.getCredits(sourceBranch.getLastPlayer(), credits);
-      for (film &movie: credits) {
-        if (!sourceVisitedMovies.insert(movie).second) {
-          vector<string> cast;
-          db.getCast(movie, cast);
-          if (targetVisitedMovies.find(movie) != targetVisitedMovies.end()) {
-
-          }
-        }
+ * Same as above, except that the search runs over the compiled
+ * integer graph, and names are only decoded for the final path.
+ *
+ * @param source: First actor
+ * @param target: Actor we want to find
+ * @param graph the graph compiled from the imdb housing both actors.
+ * @param landmarks the landmarks used to prune the search, or NULL.
+ * @param filter the movies and actors the path may use, or NULL for all of them.
+ * @param result set to the path from source to target, if one exists.
+ * @param stats the statistics the search adds to, or NULL.
+ * @return true if and only if a path was found.
+ */
+
+static bool generateShortestPath (const string& source, const string& target, const imdbGraph& graph,
+                                  const landmarkTable *landmarks, const searchFilter *filter, path& result,
+                                  searchStats *stats) {
+  chrono::steady_clock::time_point phase = chrono::steady_clock::now();
+  int sourceId = graph.getActorId(source);
+  vector<imdbGraph::link> links;
+  bool found = graph.findShortestPath(sourceId, graph.getActorId(target), links, landmarks, filter, stats);
+  if (stats != NULL) stats->expansionMicros += searchStats::lap(phase);
+  if (!found) return false;
+  result = graph.decodePath(sourceId, links, stats);
+  if (stats != NULL) stats->reconstructionMicros += searchStats::lap(phase);
+  return true;
+}
+
+/**
+ * Same again, except that the graph is searched outward from the source
+ * only, one level at a time, with every level spread across numThreads
+ * threads.  See imdbGraph::breadthFirstSearch.  If the packed graph is
+ * supplied, the search runs over it instead, and the graph may be NULL:
+ * the ids are the imdb's own indexes, so the path is decoded straight out
+ * of the imdb.
+ */
+
+static bool generateShortestPathParallel (const string& source, const string& target, const imdb& db,
+                                          const imdbGraph *graph, const packedGraph *packed, int numThreads,
+                                          path& result, searchStats *stats) {
+  chrono::steady_clock::time_point phase = chrono::steady_clock::now();
+  int sourceId = db.findActor(source);
+  int targetId = db.findActor(target);
+  vector<int> distances;
+  vector<imdbGraph::link> parents, links;
+  if (packed != NULL) {
+    packed->breadthFirstSearch(sourceId, targetId, numThreads, distances, parents);
+  } else {
+    graph->breadthFirstSearch(sourceId, targetId, numThreads, distances, parents);
+  }
+  bool found = imdbGraph::tracePath(distances, parents, targetId, links);
+  if (stats != NULL) stats->expansionMicros += searchStats::lap(phase);
+  if (!found) return false;
+  result = imdbGraph::decodePath(db, sourceId, links, stats);
+  if (stats != NULL) stats->reconstructionMicros += searchStats::lap(phase);
+  return true;
+}
+
+/**
+ * Pair cache
+ * ----------
+ * Answers to recent queries, keyed by the two names in alphabetical order (with
+ * a tab between them) since a path answers the query in both directions.  A
+ * NULL path records that there's no path at all.  Paths are sized by their
+ * length, at roughly kPairLinkBytes per movie and actor, plus kPairEntryBytes
+ * for the entry itself.
+ */
+
+typedef lruCache<string, shared_ptr<const path> > pairCache;
+
+static const size_t kPairEntryBytes = 192;
+static const size_t kPairLinkBytes = 128;
+
+/**
+ * Everything a query needs to know about how it should be answered: the graph
+ * is NULL if it wasn't compiled (in which case the imdb is searched directly,
+ * unless there's a packed graph), parallelThreads is the number of threads
+ * each graph search should be spread across, or 0 if searches should be
+ * bidirectional instead, packed is the compressed graph those searches
+ * should run over, if there is one (and nothing else needs the graph, it's
+ * the only graph there is),
+ * centre is the table of paths out of the centre actor, if there is one,
+ * and landmarks and components are the landmark and component tables,
+ * if there are any.  If estimate is true, queries are answered with the
+ * landmarks' bounds alone.  pairs and costars are the caches of answers
+ * and of hubs' co-stars, if there are any, and filter restricts the movies
+ * and actors paths may use, if it isn't NULL.  paths says whether queries are
+ * answered with one shortest path or with several (see writePaths), and
+ * pathLimit how many.  names is the index that completes names, if there is one.
+ * If collectStats is true, every query counts what answering it cost (see
+ * searchStats).
+ */
+
+enum pathMode { kOnePath, kAllShortestPaths, kShortestSimplePaths };
+
+struct searchContext {
+  const imdb& db;
+  const imdbGraph *graph;
+  int parallelThreads;
+  const packedGraph *packed;
+  const baconTable *centre;
+  const landmarkTable *landmarks;
+  const componentTable *components;
+  bool estimate;
+  pairCache *pairs;
+  costarCache *costars;
+  const searchFilter *filter;
+  pathMode paths;
+  long long pathLimit;
+  const nameIndex *names;
+  bool collectStats;
+};
+
+/**
+ * Queries to or from the centre actor never search at all: the
+ * path is read straight out of the centre's table instead.
+ */
+
+static bool generateShortestPathToCentre (const string& source, const string& target, const imdbGraph& graph,
+                                          const baconTable& centre, path& result, searchStats *stats) {
+  chrono::steady_clock::time_point phase = chrono::steady_clock::now();
+  int sourceId = graph.getActorId(source);
+  int targetId = graph.getActorId(target);
+  vector<imdbGraph::link> links;
+  bool found = sourceId == centre.getCentre() ? centre.tracePathFromCentre(targetId, links) :
+                                                centre.tracePathToCentre(sourceId, links);
+  if (stats != NULL) stats->expansionMicros += searchStats::lap(phase);
+  if (!found) return false;
+  result = graph.decodePath(sourceId, links, stats);
+  if (stats != NULL) stats->reconstructionMicros += searchStats::lap(phase);
+  return true;
+}
+
+static bool searchShortestPath (const string& source, const string& target,
+                                const searchContext& context, path& result, searchStats *stats) {
+  if (context.components != NULL &&
+      !context.components->connected(context.db.findActor(source), context.db.findActor(target)))
+    return false;
+  if (context.graph == NULL && context.packed != NULL)
+    return generateShortestPathParallel(source, target, context.db, NULL, context.packed,
+                                        context.parallelThreads, result, stats);
+  if (context.graph == NULL) return generateShortestPath(source, target, context.db, context.costars, result, stats);
+  // the centre's paths and the parallel search don't know about the filter
+  if (context.filter != NULL)
+    return generateShortestPath(source, target, *context.graph, context.landmarks, context.filter, result, stats);
+  if (context.centre != NULL) {
+    int centre = context.centre->getCentre();
+    if (context.graph->getActorId(source) == centre || context.graph->getActorId(target) == centre)
+      return generateShortestPathToCentre(source, target, *context.graph, *context.centre, result, stats);
+  }
+  if (context.parallelThreads > 0) {
+    int lower, upper;
+    if (context.landmarks != NULL &&
+        !context.landmarks->getBounds(context.graph->getActorId(source), context.graph->getActorId(target), lower, upper))
+      return false;
+    return generateShortestPathParallel(source, target, context.db, context.graph, context.packed,
+                                        context.parallelThreads, result, stats);
+  }
+  return generateShortestPath(source, target, *context.graph, context.landmarks, NULL, result, stats);
+}
+
+/**
+ * Answers a query out of the pair cache if it's there, and otherwise searches
+ * (in alphabetical order, so that the cached path reads in that order too)
+ * and caches the answer.  A query answered out of the cache adds nothing to
+ * stats (which may be NULL).
+ */
+
+static bool generateShortestPath (const string& source, const string& target,
+                                  const searchContext& context, path& result, searchStats *stats) {
+  if (context.pairs == NULL) return searchShortestPath(source, target, context, result, stats);
+  bool reversed = target < source;
+  const string& first = reversed ? target : source;
+  const string& second = reversed ? source : target;
+  string key = first + "\t" + second;
+  shared_ptr<const path> cached;
+  if (!context.pairs->get(key, cached)) {
+    path found(first);
+    if (searchShortestPath(first, second, context, found, stats)) cached = make_shared<const path>(found);
+    context.pairs->put(key, cached, kPairEntryBytes + key.size() +
+                       (cached == NULL ? 0 : cached->getLength() * kPairLinkBytes));
+  }
+  if (cached == NULL) return false;
+  result = *cached;
+  if (reversed) result.reverse();
+  return true;
+}
+
+/**
+ * Answers a query with several paths rather than one: with every shortest
+ * path between the two actors (see shortestPaths), or with the shortest simple
+ * paths in order of length (see kShortestPaths), up to pathLimit of them (or
+ * with no limit, if pathLimit is 0 and every shortest path was asked for).
+ * Each path is decoded and written as soon as it's enumerated, preceded by a
+ * line holding its number and length, so nothing is held but the path at hand.
+ *
+ * @param distance set to the length of the shortest path, or -1 if there's none.
+ * @param numPaths set to the number of shortest paths when every shortest path
+ *                 was asked for, and to the number of paths written otherwise.
+ * @param stats the statistics the enumeration adds its time and the bytes it
+ *              decodes to, or NULL.  Decoding and writing counts as reconstruction,
+ *              and everything else as expansion.
+ */
+
+static void writePaths (const string& source, const string& target, const searchContext& context,
+                        ostream& out, int& distance, double& numPaths, searchStats *stats) {
+  distance = -1;
+  numPaths = 0;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  double decoding = 0;
+  int sourceId = context.graph->getActorId(source);
+  int targetId = context.graph->getActorId(target);
+  if (context.components != NULL && !context.components->connected(sourceId, targetId)) return;
+
+  vector<imdbGraph::link> links;
+  long long written = 0;
+  auto write = [&]() {
+    chrono::steady_clock::time_point phase = chrono::steady_clock::now();
+    out << "\t#" << ++written << " (" << links.size() << " movies)" << endl
+        << context.graph->decodePath(sourceId, links, stats);
+    decoding += searchStats::lap(phase);
+  };
+  if (context.paths == kAllShortestPaths) {
+    shortestPaths all(*context.graph, sourceId, targetId, context.filter);
+    distance = all.getDistance();
+    numPaths = all.getNumPaths();
+    while ((context.pathLimit == 0 || written < context.pathLimit) && all.next(links)) write();
+  } else {
+    kShortestPaths simple(*context.graph, sourceId, targetId, context.filter);
+    while (written < context.pathLimit && simple.next(links)) {
+      if (written == 0) distance = links.size();
+      write();
+    }
+    numPaths = written;
+  }
+  if (stats != NULL) {
+    stats->expansionMicros += searchStats::lap(start) - decoding;
+    stats->reconstructionMicros += decoding;
+  }
+}
+
+/**
+ * Answers a query with the landmarks' bounds alone, without searching: the
+ * distance if the bounds agree, a range like "2-4" (or "2-" if there's no
+ * upper bound) if they don't, and "none" if the landmarks prove there's no
+ * path at all.
+ */
+
+static string estimateDistance (const string& source, const string& target, const searchContext& context) {
+  if (context.components != NULL &&
+      !context.components->connected(context.db.findActor(source), context.db.findActor(target)))
+    return "none";
+  int lower, upper;
+  if (!context.landmarks->getBounds(context.graph->getActorId(source), context.graph->getActorId(target), lower, upper))
+    return "none";
+  ostringstream estimate;
+  estimate << lower;
+  if (upper != lower) estimate << "-";
+  if (upper != lower && upper != landmarkTable::kUnbounded) estimate << upper;
+  return estimate.str();
+}
+
+/**
+ * Maps the landmark table out of the data directory if it's there, current,
+ * and has the requested number of landmarks, and otherwise builds it and saves
+ * it there for next time, the same way loadCentre does.
+ */
+
+static const int kDefaultLandmarks = 16;
+
+static const landmarkTable *loadLandmarks(int numLandmarks, const string& directory,
+                                          const imdbGraph& graph, int numThreads)
+{
+  const string fileName = directory + "/" + landmarkTable::kFileName;
+  landmarkTable *table = new landmarkTable(graph, fileName);
+  if (table->good() && table->getNumLandmarks() == min(numLandmarks, graph.getNumActors())) return table;
+
+  delete table;
+  table = new landmarkTable(graph, numLandmarks, numThreads);
+  if (!table->save(fileName))
+    cerr << "Couldn't save the landmark table to " << fileName << "." << endl;
+  return table;
+}
+
+/**
+ * Maps the packed graph out of the data directory if it's there and current,
+ * and otherwise packs the graph and saves it there for next time (which is
+ * what the imdb-pack tool does ahead of time).  If graph is NULL, it's only
+ * compiled if there's packing to do, and then released again.  Returns NULL
+ * if the packed graph can't be saved.
+ */
+
+static const packedGraph *loadPacked(const string& directory, const imdb& db, const imdbGraph *graph)
+{
+  const string fileName = directory + "/" + packedGraph::kFileName;
+  packedGraph *packed = new packedGraph(db, fileName);
+  if (packed->good()) return packed;
+
+  delete packed;
+  const imdbGraph *packing = graph != NULL ? graph : new imdbGraph(db);
+  bool written = packedGraph::write(*packing, fileName);
+  if (packing != graph) delete packing;
+  if (!written) {
+    cerr << "Couldn't save the packed graph to " << fileName << "." << endl;
+    return NULL;
+  }
+  packed = new packedGraph(db, fileName);
+  if (packed->good()) return packed;
+  delete packed;
+  return NULL;
+}
+
+/**
+ * Maps the centre actor's table out of the data directory if it's there and
+ * current, and otherwise builds it with one full search and saves it there
+ * for next time.  Returns NULL if the actor isn't in the database.
+ */
+
+static const baconTable *loadCentre(const string& name, const string& directory,
+                                    const imdbGraph& graph, int numThreads)
+{
+  int centre = graph.getActorId(name);
+  if (centre == -1) return NULL;
+  const string fileName = directory + "/" + baconTable::kFileName;
+  baconTable *table = new baconTable(graph, fileName);
+  if (table->good() && table->getCentre() == centre) return table;
+
+  delete table;
+  table = new baconTable(graph, centre, numThreads);
+  if (!table->save(fileName))
+    cerr << "Couldn't save the table for " << name << " to " << fileName << "." << endl;
+  return table;
+}
+
+/**
+ * Maps the component table out of the data directory if it's there and
+ * current, and otherwise builds it and saves it there for next time, the
+ * same way loadCentre does.  Either way, the sizes of the largest
+ * components are published to cerr.
+ */
+
+static const int kReportedComponents = 5;
+
+static const componentTable *loadComponents(const string& directory, const imdbGraph& graph)
+{
+  const string fileName = directory + "/" + componentTable::kFileName;
+  componentTable *table = new componentTable(graph, fileName);
+  if (!table->good()) {
+    delete table;
+    table = new componentTable(graph);
+    if (!table->save(fileName))
+      cerr << "Couldn't save the component table to " << fileName << "." << endl;
+  }
+
+  cerr << graph.getNumActors() << " actors in " << table->getNumComponents() << " components (largest:";
+  for (int c = 0; c < min(kReportedComponents, table->getNumComponents()); c++)
+    cerr << " " << table->getComponentSize(c);
+  cerr << (table->getNumComponents() > kReportedComponents ? " ...)." : ").") << endl;
+  return table;
+}
+
+/**
+ * Maps the name index out of the data directory if it's there and current
+ * (imdb-index writes it), and otherwise builds it and saves it there for next
+ * time, the same way loadCentre does.
+ */
+
+static const nameIndex *loadNames(const string& directory, const imdb& db)
+{
+  const string fileName = directory + "/" + nameIndex::kFileName;
+  nameIndex *index = new nameIndex(db, fileName);
+  if (!index->good()) {
+    delete index;
+    index = new nameIndex(db);
+    if (!index->save(fileName))
+      cerr << "Couldn't save the name index to " << fileName << "." << endl;
+  }
+  return index;
+}
+
+/**
+ * Builds the filter the command line asks for, publishing an error to cerr
+ * and returning NULL if the years are malformed or any excluded actor or movie
+ * isn't in the database.  Movies are named as they're printed, as in
+ * "Footloose (1984)".
+ */
+
+static const searchFilter *loadFilter(const char *years, const vector<string>& excludedActors,
+                                      const vector<string>& excludedMovies,
+                                      const imdb& db, const imdbGraph& graph)
+{
+  searchFilter *filter = new searchFilter(graph);
+  if (years != NULL) {
+    int firstYear = 0, lastYear = 9999;
+    const char *dash = strchr(years, '-');
+    if (dash == NULL || (dash != years && sscanf(years, "%d", &firstYear) != 1) ||
+        (dash[1] != '\0' && sscanf(dash + 1, "%d", &lastYear) != 1)) {
+      cerr << "Years should look like 1990-2010, 1990- or -2010, not \"" << years << "\"." << endl;
+      delete filter;
+      return NULL;
+    }
+    filter->setYears(firstYear, lastYear);
+  }
+  for (const string& name: excludedActors) {
+    int actor = db.findActor(name);
+    if (actor == -1) {
+      cerr << "We couldn't find \"" << name << "\" in the movie database." << endl;
+      delete filter;
+      return NULL;
+    }
+    filter->excludeActor(actor);
+  }
+  for (const string& name: excludedMovies) {
+    size_t open = name.rfind(" (");
+    int year, movie = -1;
+    if (open != string::npos && name.back() == ')' && sscanf(name.c_str() + open + 2, "%d", &year) == 1)
+      movie = db.findMovie(string_view(name).substr(0, open), year);
+    if (movie == -1) {
+      cerr << "We couldn't find the movie \"" << name << "\" in the movie database." << endl;
+      delete filter;
+      return NULL;
+    }
+    filter->excludeMovie(movie);
+  }
+  return filter;
+}
+
+/**
+ * Publishes how well a cache did to cerr, so that it can be sized.
+ */
+
+template <typename Cache>
+static void reportCache(const string& name, const Cache *cache)
+{
+  if (cache == NULL) return;
+  long long lookups = cache->getHits() + cache->getMisses();
+  cerr << name << " cache: " << cache->getHits() << " hits and " << cache->getMisses() << " misses ("
+       << fixed << setprecision(1) << (lookups == 0 ? 0.0 : 100.0 * cache->getHits() / lookups)
+       << "% hit rate), " << cache->getEvictions() << " evictions, " << cache->getNumEntries()
+       << " entries in " << cache->getBytes() << " of " << cache->getCapacity() << " bytes." << endl;
+}
+
+/**
+ * Tells the user there's no path between the two actors and, when the
+ * components are known, how large each of their components is.
+ */
+
+static void reportNoPath (const string& source, const string& target, const searchContext& context) {
+  cout << endl << "No path between those two people could be found." << endl;
+  if (context.components != NULL) {
+    int sourceComponent = context.components->getComponent(context.db.findActor(source));
+    int targetComponent = context.components->getComponent(context.db.findActor(target));
+    cout << source << " is one of " << context.components->getComponentSize(sourceComponent)
+         << " actors in component " << sourceComponent << ", and " << target << " is one of "
+         << context.components->getComponentSize(targetComponent) << " in component "
+         << targetComponent << "." << endl;
+  }
+  cout << endl;
+}
+
+/**
+ * Looks both actors up, as the first phase of answering a query between them,
+ * and counts the query, its lookups and the time they took into stats, unless
+ * it's NULL.
+ *
+ * @return true if and only if both actors are in the database.
+ */
+
+static bool findActors (const string& source, const string& target, const imdb& db, searchStats *stats) {
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  bool found = db.findActor(source, stats) != -1 && db.findActor(target, stats) != -1;
+  if (stats != NULL) {
+    stats->queries++;
+    stats->lookupMicros += searchStats::lap(start);
+  }
+  return found;
+}
+
+/**
+ * Startup timing
+ * --------------
+ * Everything is timed from the moment the program starts, so that cold starts
+ * can be compared with warm ones (see --populate and --warm): how long each
+ * phase of startup took, and how long it took to answer the first query.
+ */
+
+static const chrono::steady_clock::time_point programStart = chrono::steady_clock::now();
+
+static double millisSinceStart()
+{
+  return chrono::duration<double, milli>(chrono::steady_clock::now() - programStart).count();
+}
+
+/**
+ * Batch mode
+ * ----------
+ * Reads (source, target) pairs, one per line with a tab between the two
+ * names, and answers them on numThreads threads that all share the one
+ * read-only imdb (and graph).  When each search is itself parallel, the queries
+ * are answered one at a time instead.  Input is consumed in blocks of kBatchBlockSize
+ * pairs: each block is answered in parallel and then published in input order,
+ * so the output is deterministic no matter how many threads are used, and
+ * memory doesn't grow with the length of the input.  Every answer starts with
+ * a header line of tab-separated fields (query number, source, target, number
+ * of hops or "none" or "unknown" or, when estimating, the landmarks' estimate,
+ * latency in microseconds), followed by the
+ * lines of the path itself, each of which starts with a tab.  When answering
+ * with several paths (see writePaths), the header also holds the number of
+ * paths just before the latency, and the paths follow one after another, each
+ * introduced by a line (starting with a tab) holding its number.  Each block of
+ * answers is held in memory until it's published, so set a limit on the paths.  A summary of
+ * throughput and latency percentiles is published to cerr at the end.  When the
+ * context collects stats, each query's are published to cerr (in input order,
+ * introduced by its number) along with its answer, and their totals at the end.
+ */
+
+static const int kBatchBlockSize = 4096;
+
+struct batchQuery {
+  string source;
+  string target;
+  string answer;
+  double micros;
+  double finished;             // milliseconds since the program started
+  searchStats stats;           // only collected if the context asks for them
+};
+
+static void answerQuery(batchQuery& query, const searchContext& context)
+{
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  ostringstream answer, paths;
+  path result(query.source);
+  searchStats *stats = context.collectStats ? &query.stats : NULL;
+  if (!findActors(query.source, query.target, context.db, stats)) {
+    answer << "unknown";
+  } else if (query.source == query.target) {
+    answer << 0;
+  } else if (context.paths != kOnePath) {
+    int distance;
+    double numPaths;
+    writePaths(query.source, query.target, context, paths, distance, numPaths, stats);
+    if (distance == -1) answer << "none";
+    else answer << distance;
+    answer << "\t" << fixed << setprecision(0) << numPaths;
+  } else if (context.estimate) {
+    chrono::steady_clock::time_point phase = chrono::steady_clock::now();
+    answer << estimateDistance(query.source, query.target, context);
+    if (stats != NULL) stats->expansionMicros += searchStats::lap(phase);
+  } else if (generateShortestPath(query.source, query.target, context, result, stats)) {
+    answer << result.getLength();
+  } else {
+    answer << "none";
+  }
+  query.micros = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+  query.finished = millisSinceStart();
+
+  answer << "\t" << fixed << setprecision(1) << query.micros << endl;
+  if (result.getLength() > 0) answer << result;
+  query.answer = answer.str() + paths.str();
+}
+
+static void runBatch(istream& in, const searchContext& context, int numThreads, bool reportStartup)
+{
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  vector<double> latencies;
+  searchStats totals;
+  string line;
+  while (in) {
+    vector<batchQuery> block;
+    while ((int) block.size() < kBatchBlockSize && getline(in, line)) {
+      if (line.empty()) continue;
+      size_t tab = line.find('\t');
+      batchQuery query;
+      query.source = line.substr(0, tab);
+      query.target = tab == string::npos ? "" : line.substr(tab + 1);
+      block.push_back(query);
+    }
+
+    atomic<int> next(0);
+    vector<thread> workers;
+    for (int i = 0; i < numThreads; i++) {
+      workers.push_back(thread([&]() {
+        for (int j = next++; j < (int) block.size(); j = next++) answerQuery(block[j], context);
+      }));
+    }
+    for (thread& worker: workers) worker.join();
+
+    for (const batchQuery& query: block) {
+      if (reportStartup && latencies.empty())
+        cerr << "First query answered " << fixed << setprecision(1) << query.finished
+             << " ms after startup, in " << query.micros << " microseconds." << endl;
+      latencies.push_back(query.micros);
+      cout << latencies.size() << "\t" << query.source << "\t" << query.target << "\t" << query.answer;
+      if (context.collectStats) {
+        cerr << "Query " << latencies.size() << ": " << query.stats << "." << endl;
+        totals.add(query.stats);
       }
     }
-    n = targetBranches.size();
   }
-  return false;
+  cout << flush;
+
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  sort(latencies.begin(), latencies.end());
+  cerr << "Answered " << latencies.size() << " queries in " << fixed << setprecision(3) << seconds
+       << " seconds on " << numThreads << " threads (" << setprecision(1)
+       << latencies.size() / seconds << " queries/sec)." << endl;
+  if (!latencies.empty()) {
+    cerr << "Latency in microseconds: p50 " << latencies[latencies.size() / 2]
+         << ", p99 " << latencies[latencies.size() * 99 / 100]
+         << ", max " << latencies.back() << "." << endl;
+  }
+  if (context.collectStats) cerr << "Totals over " << totals.queries << " queries: " << totals << "." << endl;
+}
+
+/**
+ * Server mode
+ * -----------
+ * Answers the same (source, target) lines batch mode reads, but sent over a
+ * Unix domain socket by any number of clients at once (see queryServer), so
+ * that they share one resident imdb, graph and set of tables instead of each
+ * paying to load and warm their own.  The answer to each line is the same
+ * header line and path lines batch mode publishes, less the query number,
+ * followed by an empty line to mark its end.  With a name index, a line that
+ * starts with a ? asks for the most prolific actors whose names start with the
+ * rest of it instead, and is answered with a header line holding the prefix
+ * and the number of names, the names (each starting with a tab), and an empty
+ * line.  A line that starts with an @ asks who the actor named by the rest of
+ * it has worked with (see imdb::getCostars), and is answered with a header
+ * line holding the request and the number of co-stars (or -1 if there's no
+ * such actor), a line per co-star with the name and the number of movies
+ * shared (each starting with a tab), and an empty line.  SIGINT and SIGTERM
+ * shut the server down cleanly.
+ */
+
+static queryServer *runningServer = NULL;
+
+static void stopServer(int signal)
+{
+  if (runningServer != NULL) runningServer->stop();
+}
+
+static string answerRequest(const string& request, const searchContext& context)
+{
+  if (context.names != NULL && !request.empty() && request[0] == '?') {
+    vector<int> ids;
+    context.names->completeActors(string_view(request).substr(1), kNumSuggestions, ids);
+    string answer = request + "\t" + to_string(ids.size()) + "\n";
+    for (int id: ids) answer += "\t" + string(context.db.getActor(context.db.getActorOffset(id)).name) + "\n";
+    return answer + "\n";
+  }
+  if (!request.empty() && request[0] == '@') {
+    vector<imdb::costar> costars;
+    bool found = context.db.getCostars(string_view(request).substr(1), costars);
+    string answer = request + "\t" + to_string(found ? (int) costars.size() : -1) + "\n";
+    for (const imdb::costar& c: costars)
+      answer += "\t" + string(context.db.getActorName(c.actor)) + "\t" + to_string(c.numShared) + "\n";
+    return answer + "\n";
+  }
+  size_t tab = request.find('\t');
+  batchQuery query;
+  query.source = request.substr(0, tab);
+  query.target = tab == string::npos ? "" : request.substr(tab + 1);
+  answerQuery(query, context);
+  return query.source + "\t" + query.target + "\t" + query.answer + "\n";
+}
+
+static bool runServer(const string& socketPath, const searchContext& context, int numThreads)
+{
+  queryServer server(socketPath, numThreads, [&](const string& request) {
+    return answerRequest(request, context);
+  });
+  if (!server.good()) return false;
+
+  runningServer = &server;
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = stopServer;
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+  cerr << "Serving on " << socketPath << " with " << numThreads << " workers." << endl;
+  server.run();
+  signal(SIGINT, SIG_DFL);
+  signal(SIGTERM, SIG_DFL);
+  runningServer = NULL;
+  cerr << "Answered " << server.getNumServed() << " requests." << endl;
+  return true;
+}
+
+/**
+ * Interactive mode
+ * ----------------
+ * Prompts for pairs of actors until either prompt is left empty, and answers
+ * each pair the way the context says to: with several paths, an estimate, or
+ * a single shortest path.
+ */
+
+static void runInteractive(const searchContext& context, bool reportStartup)
+{
+  bool answeredAny = false;
+  while (true) {
+    string source = promptForActor("Actor or actress", context.db, context.names);
+    if (source == "") break;
+    string target = promptForActor("Another actor or actress", context.db, context.names);
+    if (target == "") break;
+    searchStats queryStats;
+    searchStats *stats = context.collectStats && source != target ? &queryStats : NULL;
+    if (stats != NULL) findActors(source, target, context.db, stats);
+    if (source == target) {
+      cout << "Good one.  This is only interesting if you specify two different people." << endl;
+    } else if (context.paths != kOnePath) {
+      int distance;
+      double numPaths;
+      cout << endl;
+      writePaths(source, target, context, cout, distance, numPaths, stats);
+      if (distance == -1) {
+        reportNoPath(source, target, context);
+      } else if (context.paths == kAllShortestPaths) {
+        cout << endl << "There are " << fixed << setprecision(0) << numPaths << " paths of " << distance
+             << " movies between " << source << " and " << target << "." << endl << endl;
+      } else {
+        cout << endl << "Those are the " << numPaths << " shortest paths between " << source << " and "
+             << target << " that never revisit an actor or a movie." << endl << endl;
+      }
+    } else if (context.estimate) {
+      chrono::steady_clock::time_point phase = chrono::steady_clock::now();
+      string distance = estimateDistance(source, target, context);
+      if (stats != NULL) stats->expansionMicros += searchStats::lap(phase);
+      if (distance == "none") {
+        reportNoPath(source, target, context);
+      } else {
+        cout << endl << source << " and " << target << " are " << distance << " movies apart." << endl << endl;
+      }
+    } else {
+      chrono::steady_clock::time_point start = chrono::steady_clock::now();
+      path result(source);
+      bool found = generateShortestPath(source, target, context, result, stats);
+      if (reportStartup && !answeredAny) {
+        cerr << "First query answered in " << fixed << setprecision(1)
+             << chrono::duration<double, micro>(chrono::steady_clock::now() - start).count()
+             << " microseconds." << endl;
+      }
+      answeredAny = true;
+      if (found) {
+        cout << "\n" << result << "\n";
+      } else {
+        reportNoPath(source, target, context);
+      }
+    }
+    if (stats != NULL) cerr << "Stats: " << queryStats << "." << endl;
+  }
+  cout << "Thanks for playing!" << endl;
+}
+
+/**
+ * Reads the count that may follow a flag such as --landmarks.  The next
+ * argument is only taken as the count if the whole of it is a number, so
+ * that a data directory named 2024data isn't mistaken for one.
+ *
+ * @return true if argv[i + 1] was a count, in which case i is advanced past it.
+ */
+
+static bool parseOptionalCount(int argc, const char *argv[], int& i, long long& count)
+{
+  if (i + 1 >= argc || !isdigit((unsigned char) argv[i + 1][0])) return false;
+  char *end;
+  errno = 0;
+  long long value = strtoll(argv[i + 1], &end, 10);
+  if (*end != '\0' || errno == ERANGE) return false;
+  count = value;
+  i++;
+  return true;
 }
-*/
 
 /**
  * Serves as the main entry point for the six-degrees executable.
- * There are no parameters to speak of.
  *
  * @param argc the number of tokens passed to the command line to
- *             invoke this executable.  It's completely ignored
- *             here, because we don't expect any arguments.
+ *             invoke this executable.
  * @param argv the C strings making up the full command line.
  *             We expect argv[0] to be logically equivalent to
  *             "six-degrees" (or whatever absolute path was used to
- *             invoke the program), but otherwise these are ignored
- *             as well.
+ *             invoke the program).  Any other argument not recognized
+ *             as a flag names the data directory.  The flags are:
+ *
+ *                --no-graph      skip compiling the integer graph and search
+ *                                the imdb directly instead (slower per query,
+ *                                but there's nothing to build at startup).
+ *                                Not allowed when the data directory has a
+ *                                delta, which only the graph merges in.
+ *                --batch <file>  answer the pairs in the specified file (or on
+ *                                standard input, if the file is "-") instead
+ *                                of prompting for them.  See runBatch.
+ *                --parallel      answer each query with a single-sided, level-
+ *                                synchronous search of the graph, with every level
+ *                                spread across all threads (see breadthFirstSearch),
+ *                                instead of with a bidirectional search.
+ *                --packed        run those searches over the compressed graph saved to
+ *                                graph in the data directory (see imdb-pack), packing
+ *                                it first if it isn't there or isn't current.  Implies
+ *                                --parallel.  Unless something else needs the graph,
+ *                                it's never held in memory next to the packed one.
+ *                --centre <name> answer every query to or from the named actor (a
+ *                                Kevin Bacon, say) straight out of a table of paths
+ *                                out of that actor, which is saved to bacontable in
+ *                                the data directory and reused for as long as it's current.
+ *                --landmarks <k> prune every bidirectional search with the bounds
+ *                                given by k landmark actors (16 if k is omitted),
+ *                                whose distances are saved to landmarks in the data
+ *                                directory and reused for as long as they're current.
+ *                --estimate      answer with the landmarks' bounds on the distance
+ *                                only, without searching (implies --landmarks).
+ *                --components    reject queries between actors in different connected
+ *                                components without searching, using a table of
+ *                                components saved to components in the data directory
+ *                                and reused for as long as it's current.
+ *                --populate      page in all of the data files up front (see imdb::populate).
+ *                --warm <file>   page in just the offset tables, plus the pages listed in
+ *                                the specified access profile ("-" for no profile).
+ *                --record-profile <file> on the way out, save the pages of the data files
+ *                                that are resident as an access profile for --warm.
+ *                                With any of these three, or in batch mode, the time
+ *                                each phase of startup took, and the time to the first
+ *                                answer, are published to cerr.
+ *                --serve <path>  answer pairs sent over a Unix domain socket bound to
+ *                                the specified path instead of prompting for them,
+ *                                until interrupted.  See runServer.
+ *                --years <first>-<last> only use movies released from first to last
+ *                                inclusive (either may be omitted, as in 1990- or -2010).
+ *                --exclude-actor <name> never pass through the named actor or actress.
+ *                --exclude-movie <title (year)> never pass through the named movie.
+ *                                Both may be given any number of times.  These three
+ *                                need the graph, and override --centre and --parallel.
+ *                --all-paths [n] answer with every shortest path (or the first n of them),
+ *                                rather than just one, and their number.
+ *                --k-paths <k>   answer with the k shortest paths that never revisit an
+ *                                actor or a movie.  These two need the graph, and honour
+ *                                the filters above.  See writePaths.
+ *                --names         complete names ending in * and suggest corrections for
+ *                                names that can't be found (and, in server mode, answer
+ *                                requests for completions), using the name index saved
+ *                                to nameindex in the data directory.  See promptForActor.
+ *                --stats         count what answering each query cost (lookups, actors and
+ *                                movies expanded, frontiers, bytes of the data touched, and
+ *                                the time spent in each phase) and publish it to cerr, per
+ *                                query and, in batch mode, in total.  See searchStats.
+ *                --cache <mb>    cache answers, and the co-stars of hubs when the imdb is
+ *                                searched directly, in at most the specified number of
+ *                                megabytes, and publish the caches' hit rates to cerr
+ *                                on the way out.  See pairCache and costarCache.
+ *                --threads <n>   the number of threads batch or server mode (or each
+ *                                parallel search) should use, which defaults to the number of cores.
+ *
  * @return 0 if the program ends normally, and undefined otherwise.
  */
 
 int main(int argc, const char *argv[])
 {
-  imdb db(determinePathToData(argv[1])); // inlined in imdb-utils.h
+  const char *dataPath = NULL;
+  const char *batchFile = NULL;
+  const char *socketPath = NULL;
+  const char *centreName = NULL;
+  int numLandmarks = 0;
+  bool estimate = false;
+  bool useComponents = false;
+  int numThreads = max(1, (int) thread::hardware_concurrency());
+  bool useGraph = true;
+  bool parallel = false;
+  bool usePacked = false;
+  bool populate = false;
+  const char *warmProfile = NULL;
+  const char *recordProfile = NULL;
+  size_t cacheBytes = 0;
+  const char *years = NULL;
+  vector<string> excludedActors, excludedMovies;
+  bool useNames = false;
+  bool collectStats = false;
+  pathMode paths = kOnePath;
+  long long pathLimit = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--no-graph") == 0) useGraph = false;
+    else if (strcmp(argv[i], "--parallel") == 0) parallel = true;
+    else if (strcmp(argv[i], "--packed") == 0) usePacked = parallel = true;
+    else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) batchFile = argv[++i];
+    else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) socketPath = argv[++i];
+    else if (strcmp(argv[i], "--centre") == 0 && i + 1 < argc) centreName = argv[++i];
+    else if (strcmp(argv[i], "--landmarks") == 0) {
+      long long count;
+      numLandmarks = parseOptionalCount(argc, argv, i, count) ? (int) min(count, (long long) INT_MAX) : kDefaultLandmarks;
+    } else if (strcmp(argv[i], "--estimate") == 0) estimate = true;
+    else if (strcmp(argv[i], "--components") == 0) useComponents = true;
+    else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) numThreads = max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--years") == 0 && i + 1 < argc) years = argv[++i];
+    else if (strcmp(argv[i], "--exclude-actor") == 0 && i + 1 < argc) excludedActors.push_back(argv[++i]);
+    else if (strcmp(argv[i], "--exclude-movie") == 0 && i + 1 < argc) excludedMovies.push_back(argv[++i]);
+    else if (strcmp(argv[i], "--names") == 0) useNames = true;
+    else if (strcmp(argv[i], "--stats") == 0) collectStats = true;
+    else if (strcmp(argv[i], "--all-paths") == 0) {
+      paths = kAllShortestPaths;
+      if (!parseOptionalCount(argc, argv, i, pathLimit)) pathLimit = 0;
+    } else if (strcmp(argv[i], "--k-paths") == 0 && i + 1 < argc) {
+      paths = kShortestSimplePaths;
+      pathLimit = max(1LL, atoll(argv[++i]));
+    } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) cacheBytes = max(0, atoi(argv[++i])) * (1ULL << 20);
+    else if (strcmp(argv[i], "--populate") == 0) populate = true;
+    else if (strcmp(argv[i], "--warm") == 0 && i + 1 < argc) warmProfile = argv[++i];
+    else if (strcmp(argv[i], "--record-profile") == 0 && i + 1 < argc) recordProfile = argv[++i];
+    else dataPath = argv[i];
+  }
+  bool reportStartup = populate || warmProfile != NULL || recordProfile != NULL || batchFile != NULL;
+
+  const string directory = determinePathToData(dataPath); // inlined in imdb-utils.h
+  imdb db(directory);
   if (!db.good()) {
     cout << "Failed to properly initialize the imdb database." << endl;
     cout << "Please check to make sure the source files exist and that you have permission to read them." << endl;
     exit(1);
   }
-  
-  while (true) {
-    string source = promptForActor("Actor or actress", db);
-    if (source == "") break;
-    string target = promptForActor("Another actor or actress", db);
-    if (target == "") break;
-    if (source == target) {
-      cout << "Good one.  This is only interesting if you specify two different people." << endl;
+  double opened = millisSinceStart();
+  if (populate) db.populate();
+  if (warmProfile != NULL && !db.warm(strcmp(warmProfile, "-") == 0 ? "" : warmProfile))
+    cerr << "Couldn't use the access profile in \"" << warmProfile << "\"; only the offset tables were warmed." << endl;
+  double warmed = millisSinceStart();
+
+  // searches of the imdb itself walk the records in the data files, which the delta isn't part of
+  if (!useGraph && db.hasDelta()) {
+    cerr << "The delta in " << directory << " needs the graph." << endl;
+    exit(1);
+  }
+  // the packed graph stands in for the graph, unless something else needs the graph itself
+  if (estimate && numLandmarks <= 0) numLandmarks = kDefaultLandmarks;
+  bool needsGraph = !usePacked || centreName != NULL || numLandmarks > 0 || useComponents ||
+                    paths != kOnePath || years != NULL || !excludedActors.empty() || !excludedMovies.empty();
+  imdbGraph *graph = useGraph && needsGraph ? new imdbGraph(db) : NULL;
+  double compiled = millisSinceStart();
+  const packedGraph *packed = NULL;
+  if (usePacked) {
+    if (useGraph) packed = loadPacked(directory, db, graph);
+    if (packed == NULL) {
+      cerr << "The packed graph needs the graph, and a data directory it can be saved to." << endl;
+      exit(1);
+    }
+  }
+  const baconTable *centre = NULL;
+  if (centreName != NULL) {
+    if (graph != NULL) centre = loadCentre(centreName, directory, *graph, numThreads);
+    if (centre == NULL) {
+      cerr << "The centre needs the graph, and an actor or actress in the database." << endl;
+      exit(1);
+    }
+  }
+  const landmarkTable *landmarks = NULL;
+  if (numLandmarks > 0) {
+    if (graph == NULL) {
+      cerr << "The landmarks need the graph." << endl;
+      exit(1);
+    }
+    landmarks = loadLandmarks(numLandmarks, directory, *graph, numThreads);
+  }
+  const componentTable *components = NULL;
+  if (useComponents) {
+    if (graph == NULL) {
+      cerr << "The components need the graph." << endl;
+      exit(1);
+    }
+    components = loadComponents(directory, *graph);
+  }
+  if (paths != kOnePath && (graph == NULL || estimate)) {
+    cerr << "Answering with several paths needs the graph, and can't be combined with --estimate." << endl;
+    exit(1);
+  }
+  const searchFilter *filter = NULL;
+  if (years != NULL || !excludedActors.empty() || !excludedMovies.empty()) {
+    if (graph == NULL || estimate) {
+      cerr << "Filtering paths needs the graph, and can't be combined with --estimate." << endl;
+      exit(1);
+    }
+    filter = loadFilter(years, excludedActors, excludedMovies, db, *graph);
+    if (filter == NULL) exit(1);
+  }
+  const nameIndex *names = useNames ? loadNames(directory, db) : NULL;
+  // the co-star cache is only used when there's no graph, in which case it gets half the space
+  pairCache *pairs = cacheBytes > 0 ? new pairCache(useGraph ? cacheBytes : cacheBytes / 2) : NULL;
+  costarCache *costars = cacheBytes > 0 && !useGraph ? new costarCache(cacheBytes / 2) : NULL;
+  searchContext context = { db, graph, parallel && useGraph ? numThreads : 0, packed,
+                            centre, landmarks, components, estimate, pairs, costars, filter,
+                            paths, pathLimit, names, collectStats };
+  if (reportStartup) {
+    double ready = millisSinceStart();
+    cerr << "Ready " << fixed << setprecision(1) << ready << " ms after startup (opening the data "
+         << opened << " ms, warming it " << warmed - opened << " ms, compiling the graph "
+         << compiled - warmed << " ms, loading tables " << ready - compiled << " ms)." << endl;
+  }
+
+  // every mode falls through to the one teardown below
+  int status = 0;
+  if (socketPath != NULL) {
+    if (!runServer(socketPath, context, parallel ? 1 : numThreads)) {
+      cerr << "Couldn't listen on \"" << socketPath << "\"." << endl;
+      status = 1;
+    }
+  } else if (batchFile != NULL) {
+    ifstream file;
+    if (strcmp(batchFile, "-") != 0) file.open(batchFile);
+    if (strcmp(batchFile, "-") != 0 && !file) {
+      cerr << "Failed to open \"" << batchFile << "\"." << endl;
+      status = 1;
     } else {
-      // replace the following line by a call to your generateShortestPath routine... 
-      if (!generateShortestPathV1(source, target, db, false)) {
-        cout << endl << "No path between those two people could be found." << endl << endl;
-      }
+      runBatch(file.is_open() ? file : cin, context, parallel ? 1 : numThreads, reportStartup);
     }
+  } else {
+    runInteractive(context, reportStartup);
   }
-  
-  cout << "Thanks for playing!" << endl;
-  return 0;
-}
 
+  if (recordProfile != NULL && !db.recordProfile(recordProfile))
+    cerr << "Couldn't save the access profile to \"" << recordProfile << "\"." << endl;
+  reportCache("Pair", pairs);
+  reportCache("Co-star", costars);
+  delete costars;
+  delete pairs;
+  delete filter;
+  delete names;
+  delete components;
+  delete landmarks;
+  delete centre;
+  delete packed;
+  delete graph;
+  return status;
+}
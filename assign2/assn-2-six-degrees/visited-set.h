@@ -0,0 +1,80 @@
+#ifndef __visited_set__
+#define __visited_set__
+
+#include <vector>
+using namespace std;
+
+/**
+ * Class: visitedSet
+ * -----------------
+ * A set of small non-negative integers (actor or movie ids, or record
+ * offsets scaled down), stored as a bitmap that's allocated once and then
+ * reused by query after query.  Rather than zeroing the whole bitmap at the
+ * start of every query, each 64-bit word is stamped with the epoch (query)
+ * it was last written during, and reset() just starts a new epoch: a word
+ * with a stale stamp is treated as empty, and is only zeroed the first time
+ * it's written during the new epoch.  So starting a query is free, and the
+ * cost of a query is proportional to the number of words it touches.
+ *
+ * A visitedSet isn't thread-safe; each thread should have its own.
+ */
+
+class visitedSet {
+
+ public:
+
+  visitedSet() : epoch(0) {}
+
+  /**
+   * Method: reset
+   * -------------
+   * Empties the set, making room for integers in [0, size) if it can't hold
+   * them already.  Runs in constant time unless the set grows (or once every
+   * four billion calls, when the epoch counter wraps around).
+   */
+
+  void reset(int size) {
+    size_t numWords = (size + 63) / 64;
+    if (numWords > words.size()) {
+      words.resize(numWords, 0);
+      stamps.resize(numWords, 0);
+    }
+    if (++epoch == 0) {
+      stamps.assign(stamps.size(), 0);
+      epoch = 1;
+    }
+  }
+
+  /**
+   * Methods: contains
+   *          insert
+   * -----------------
+   * Self-explanatory.  insert returns true if and only if the specified
+   * integer wasn't already in the set.
+   */
+
+  bool contains(int i) const {
+    size_t word = i >> 6;
+    return stamps[word] == epoch && ((words[word] >> (i & 63)) & 1);
+  }
+
+  bool insert(int i) {
+    size_t word = i >> 6;
+    unsigned long long mask = 1ULL << (i & 63);
+    if (stamps[word] != epoch) {
+      stamps[word] = epoch;
+      words[word] = mask;
+      return true;
+    }
+    if (words[word] & mask) return false;
+    words[word] |= mask;
+    return true;
+  }
+
+ private:
+  vector<unsigned long long> words;
+  vector<unsigned int> stamps;
+  unsigned int epoch;
+};
+
+#endif